@@ -44,11 +44,9 @@ void InputVideoController::setup()
 
 void InputVideoController::update()
 {
-    basePlayer::update();
-    if (isFrameNew())
-    {
-        preProcess(basePlayer::getPixelsRef());
-    }
+    grabFrame();
+    processFrame();
+    finishFrame();
 }
 
 void InputVideoController::play()
@@ -97,11 +95,9 @@ void InputCameraController::setup()
 
 void InputCameraController::update()
 {
-    baseGrabber::update();
-    if (isFrameNew())
-    {
-        preProcess(baseGrabber::getPixelsRef());
-    }
+    grabFrame();
+    processFrame();
+    finishFrame();
 }
 
 void InputCameraController::play()
@@ -3,9 +3,13 @@
 #include "ofMain.h"
 #include "ImageProcessing.hpp"
 #include "ofxOpenCv.h"
+#include <chrono>
 
 class BaseImagesInterface
 {
+public:
+    typedef std::chrono::steady_clock Clock;
+    
 protected:
     ofPixels    mFlipedPix, mGrayPix, mResizedPix, mCropedPix, mWarpedPix, mBinaryPix;
     ofTexture   mFlipedTex, mGrayTex, mResizedTex, mCropedTex, mWarpedTex, mBinaryTex;
@@ -14,8 +18,22 @@ protected:
     ofxCvGrayscaleImage     mCvGrayImage;
     ofxCvContourFinder      mContourFinder;
     
+    Clock::time_point       mCaptureTime;
+    bool                    bFrameNew;
+    
 public:
+    BaseImagesInterface() : bFrameNew(false)
+    {
+        // the cv images are (re)allocated in processFrame(), off the GL thread,
+        // and never drawn: they must not create textures
+        mCvImage.setUseTexture(false);
+        mCvGrayImage.setUseTexture(false);
+    }
     
+    // when the frame behind the current contours was grabbed
+    Clock::time_point getCaptureTime() const { return mCaptureTime; }
+    
+
     ofPixels& getGrayPixelsRef()      { return mGrayPix;    }
     ofPixels& getResizedPixelsRef()   { return mResizedPix; }
     ofPixels& getCropedPixelsRef()    { return mCropedPix;  }
@@ -159,7 +177,10 @@ protected:
         
         mCvGrayImage.setFromPixels(mBinaryPix);
         mContourFinder.findContours(mCvGrayImage, 0, 800*800, 127, true, true);
-        
+    }
+    
+    void uploadTextures()
+    {
         textureLoadData(mGrayPix,       mGrayTex);
         textureLoadData(mResizedPix,    mResizedTex);
         textureLoadData(mCropedPix,     mCropedTex);
@@ -180,6 +201,31 @@ public:
     virtual void stop()         = 0;
     virtual void togglePlay()   = 0;
     
+    /**
+     *  update() in three steps, so the image processing of several inputs can
+     *  run side by side: grabFrame() and finishFrame() touch the source and GL
+     *  and belong on the GL thread, processFrame() only works on this input's
+     *  own pixels and may run on any thread.
+     */
+    bool grabFrame()
+    {
+        baseImageObject::update();
+        bFrameNew = baseImageObject::isFrameNew();
+        if (bFrameNew) mCaptureTime = Clock::now();
+        return bFrameNew;
+    }
+    
+    void processFrame()
+    {
+        if (bFrameNew) preProcess(baseImageObject::getPixelsRef());
+    }
+    
+    void finishFrame()
+    {
+        if (bFrameNew) uploadTextures();
+        bFrameNew = false;
+    }
+    
     void setThreshold(float th) { mBlobThreshold = th; }
     
     ofParameterGroup& getParameterGroup()
@@ -41,6 +41,7 @@ void mainApp::setup()
     // init values
     //----------
     mMode = ON_SCREEN;
+    mInputSkew = 0;
     
     //----------
     // setup GUI parameter
@@ -68,9 +69,30 @@ void mainApp::update()
     //----------
     // make marged input pixel
     //----------
+    // sources are polled and textures uploaded on this thread, the image processing
+    // of all inputs runs on the pool; parallelFor returns only when every input is
+    // done, so the blob data controller below sees the contours of this frame
     for (auto& e : mInputImage)
     {
-        e->update();
+        e->grabFrame();
+    }
+    ThreadPool::getShared().parallelFor(mInputImage.size(), [&](int i){ mInputImage[i]->processFrame(); });
+    for (auto& e : mInputImage)
+    {
+        e->finishFrame();
+    }
+    
+    // how far apart the frames of the stitched inputs were grabbed
+    if (mInputImage.empty() == false)
+    {
+        BaseImagesInterface::Clock::time_point oldest = mInputImage.front()->getCaptureTime();
+        BaseImagesInterface::Clock::time_point newest = oldest;
+        for (const auto& e : mInputImage)
+        {
+            oldest = min(oldest, e->getCaptureTime());
+            newest = max(newest, e->getCaptureTime());
+        }
+        mInputSkew = std::chrono::duration<float, std::milli>(newest - oldest).count();
     }
     
     //----------
@@ -105,7 +127,7 @@ void mainApp::draw()
     
     if (bDrawGui) gui.draw();
 //    if (bDrawGui) VisualBlobs::smFlowTools->drawGui();
-    ofSetWindowTitle(ofToString(ofGetFrameRate()));
+    ofSetWindowTitle(ofToString(ofGetFrameRate()) + " fps, input skew " + ofToString(mInputSkew, 1) + " ms");
 }
 
 void mainApp::drawOnScreen()
@@ -1,6 +1,7 @@
 #include "ofMain.h"
 #include "../../common/utils.h"
 #include "../../common/constants.h"
+#include "../../common/ThreadPool.hpp"
 #include "InputImageController.h"
 #include "BlobDataController.h"
 #include "VisualBlobs.h"
@@ -32,6 +33,8 @@ class mainApp : public ofBaseApp
     
     ofxSyphonServer mSyponeServer;
     
+    float mInputSkew;   // ms between the oldest and newest frame of the inputs
+    
 public:
     void setup();
     void update();
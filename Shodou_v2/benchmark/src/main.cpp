@@ -0,0 +1,295 @@
+#include "ofMain.h"
+#include "InputImageController.h"
+#include "BlobTracker.h"
+#include "PhaseTimer.hpp"
+#include "AllocationCounter.h"
+#include "../../../common/ThreadPool.hpp"
+#include <fstream>
+
+/**
+ *  Headless benchmark of the vision pipeline.
+ *  Recorded frames are fed through the same preProcess -> contours -> blob
+ *  path as the app, on the calling thread, and the phases are timed with the
+ *  app's PhaseTimer.
+ *
+ *      make benchmark
+ *      benchmark/bin/benchmark --frames rec/ --size 1280x720 --ratio 2 --threads 4
+ *      benchmark/bin/benchmark --frames take1.raw --size 1280x720 --channels 1
+ *
+ *  --frames    folder of images (sorted by name), a .frames recording (RawFrameFile.hpp)
+ *              or a raw dump of GRAY8/RGB24 frames without header
+ *  --size      frames are resized to it, required for a raw dump
+ *  --channels  channels of a raw dump (1 or 3, default 3)
+ *  --ratio     RESIZE_RATIO of the controller (default 2)
+ *  --threads   threads of the contour tracer pool (default one per core)
+ *  --repeat    times the sequence is played after the warm-up pass (default 3)
+ *  --stages    MASK_STAGES list (default "open,close")
+ *  --full      process every frame completely, without change detection
+ *  --simplify  contour simplification tolerance in pixels (default 0, every point)
+ *  --adaptive  adaptive threshold instead of the global one, optionally with its
+ *              radius and offset ("--adaptive 8,4", default those of the controller)
+ *
+ *      make test-gray
+ *      benchmark/bin/benchmark --verify-gray
+ *
+ *  --verify-gray   compares every RGB -> gray kernel this CPU runs with the scalar one over
+ *                  all colors, instead of the benchmark; exits with 1 on a mismatch
+ */
+
+struct BenchmarkOptions
+{
+    string  framesPath;
+    int     width, height, channels;
+    int     resizeRatio;
+    int     numThreads;
+    int     repeat;
+    string  stages;
+    bool    bFull;
+    float   tolerance;
+    bool    bVerifyGray;
+    bool    bAdaptive;
+    int     adaptiveRadius, adaptiveOffset;     // < 0 keeps the controller's default
+
+    BenchmarkOptions()
+    : width(0), height(0), channels(3), resizeRatio(2), numThreads(0), repeat(3), stages("open,close"), bFull(false)
+    , tolerance(0), bVerifyGray(false), bAdaptive(false), adaptiveRadius(-1), adaptiveOffset(-1)
+    {}
+};
+
+
+// no capture object, the frames come from memory
+class BenchmarkSource {};
+
+class BenchmarkController : public InputImageController<BenchmarkSource>
+{
+    BlobStore       mBlobs, mLastBlobs;
+    BlobTracker     mTracker;
+    unsigned long   mLastContourFrame;
+
+    // same rebuild as BlobsDataController::updateBlobs()
+    void updateBlobs()
+    {
+        PhaseTimer::Scope timer(PhaseTimer::BLOBS);
+        const bool bCarriedOver = getContourFrame() == mLastContourFrame + 1;
+        mLastContourFrame = getContourFrame();
+        std::swap(mBlobs, mLastBlobs);
+        mTracker.update(getContourSet(), bCarriedOver, mLastBlobs, mBlobs);
+        PhaseTimer::record(PhaseTimer::LATENCY, PhaseTimer::Clock::now() - getCaptureTime());
+    }
+
+public:
+    BenchmarkController(const BenchmarkOptions& o) : mLastContourFrame(0)
+    {
+        mResizeRatio = o.resizeRatio;
+        mMaskStageList = o.stages;
+        mPendingStageList = o.stages;
+        mChangeDetection = o.bFull == false;
+        mAdaptive = o.bAdaptive;
+        if (o.adaptiveRadius >= 0) mAdaptiveRadius = o.adaptiveRadius;
+        if (o.adaptiveOffset >= 0) mAdaptiveOffset = o.adaptiveOffset;
+        mBlobs.setSimplification(o.tolerance);
+        mLastBlobs.setSimplification(o.tolerance);
+    }
+
+    void update() {}
+    void play() {}
+    void stop() {}
+    void togglePlay() {}
+
+    void process(const ofPixels& pix)
+    {
+        processFrame(pix, getSettings(), PhaseTimer::Clock::now());
+        if (receiveFrame()) updateBlobs();
+    }
+
+    int getNumBlobs() const { return mBlobs.size(); }
+    int getNumPoints() const { return mBlobs.getTotalNumPoints(); }
+};
+
+
+static bool loadRawDump(const BenchmarkOptions& o, vector<ofPixels>& frames)
+{
+    if (o.width <= 0 || o.height <= 0)
+    {
+        LOG_ERROR << "a raw dump needs --size";
+        return false;
+    }
+    std::ifstream file(o.framesPath.c_str(), std::ios::binary);
+    if (file.is_open() == false)
+    {
+        LOG_ERROR << "failed to open: " << o.framesPath;
+        return false;
+    }
+    vector<unsigned char> frame(o.width * o.height * o.channels);
+    while (file.read((char*)frame.data(), frame.size()))
+    {
+        frames.push_back(ofPixels());
+        frames.back().setFromPixels(frame.data(), o.width, o.height, o.channels);
+    }
+    return true;
+}
+
+static bool loadFrameFile(const BenchmarkOptions& o, vector<ofPixels>& frames)
+{
+    RawFramePlayer player;
+    if (player.load(o.framesPath) == false) return false;
+    for (int i = 0; i < player.getTotalNumFrames(); i++)
+    {
+        player.setFrame(i);
+        frames.push_back(player.getPixelsRef());
+        if (o.width > 0 && o.height > 0 && (player.getWidth() != o.width || player.getHeight() != o.height))
+        {
+            frames.back().resize(o.width, o.height);
+        }
+    }
+    return true;
+}
+
+static bool loadImageSequence(const BenchmarkOptions& o, vector<ofPixels>& frames)
+{
+    ofDirectory dir(o.framesPath);
+    dir.allowExt("png");
+    dir.allowExt("jpg");
+    dir.allowExt("tif");
+    dir.listDir();
+    dir.sort();
+    for (int i = 0; i < dir.size(); i++)
+    {
+        ofPixels pix;
+        if (ofLoadImage(pix, dir.getPath(i)) == false)
+        {
+            LOG_WARNING << "failed to load: " << dir.getPath(i);
+            continue;
+        }
+        if (o.width > 0 && o.height > 0 && (pix.getWidth() != o.width || pix.getHeight() != o.height))
+        {
+            pix.resize(o.width, o.height);
+        }
+        frames.push_back(pix);
+    }
+    return true;
+}
+
+static bool parseOptions(int argc, char* argv[], BenchmarkOptions& o)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const string arg = argv[i];
+        const bool bHasValue = i + 1 < argc;
+        if (arg == "--full")                        o.bFull = true;
+        else if (arg == "--verify-gray")            o.bVerifyGray = true;
+        else if (arg == "--adaptive")
+        {
+            o.bAdaptive = true;
+            // the radius and offset are optional
+            if (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0)
+            {
+                const vector<string> ro = ofSplitString(argv[++i], ",");
+                if (ro.size() != 2) return false;
+                o.adaptiveRadius = ofToInt(ro[0]);
+                o.adaptiveOffset = ofToInt(ro[1]);
+            }
+        }
+        else if (bHasValue == false)                return false;
+        else if (arg == "--frames")                 o.framesPath = argv[++i];
+        else if (arg == "--channels")               o.channels = ofToInt(argv[++i]);
+        else if (arg == "--ratio")                  o.resizeRatio = ofToInt(argv[++i]);
+        else if (arg == "--threads")                o.numThreads = ofToInt(argv[++i]);
+        else if (arg == "--repeat")                 o.repeat = ofToInt(argv[++i]);
+        else if (arg == "--stages")                 o.stages = argv[++i];
+        else if (arg == "--simplify")               o.tolerance = ofToFloat(argv[++i]);
+        else if (arg == "--size")
+        {
+            const vector<string> wh = ofSplitString(argv[++i], "x");
+            if (wh.size() != 2) return false;
+            o.width = ofToInt(wh[0]);
+            o.height = ofToInt(wh[1]);
+        }
+        else return false;
+    }
+    return o.bVerifyGray || (o.framesPath.empty() == false && (o.channels == 1 || o.channels == 3));
+}
+
+
+static bool verifyGrayKernels()
+{
+    bool bPassed = true;
+    for (const auto& e : ImageProcessing::gray::getAvailableKernels())
+    {
+        const bool bMatch = ImageProcessing::gray::verify(e.func);
+        printf("rgbToGray %-8s %s\n", e.name, bMatch ? "ok" : "MISMATCH");
+        bPassed = bPassed && bMatch;
+    }
+    return bPassed;
+}
+
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions o;
+    if (parseOptions(argc, argv, o) == false)
+    {
+        cout << "usage: " << argv[0] << " --frames <folder|raw file> [--size WxH] [--channels 1|3]"
+             << " [--ratio N] [--threads N] [--repeat N] [--stages list] [--full] [--simplify px]"
+             << " [--adaptive [radius,offset]]"
+             << " | --verify-gray" << endl;
+        return 1;
+    }
+    if (o.bVerifyGray) return verifyGrayKernels() ? 0 : 1;
+
+    // paths are relative to where the benchmark is started, not to bin/data
+    ofSetDataPathRoot(ofFilePath::getCurrentWorkingDirectory() + "/");
+
+    vector<ofPixels> frames;
+    bool bLoaded = false;
+    if (ofDirectory(o.framesPath).isDirectory())                bLoaded = loadImageSequence(o, frames);
+    else if (ofFilePath::getFileExt(o.framesPath) == "frames")  bLoaded = loadFrameFile(o, frames);
+    else                                                        bLoaded = loadRawDump(o, frames);
+    if (bLoaded == false || frames.empty())
+    {
+        LOG_ERROR << "no frames in " << o.framesPath;
+        return 1;
+    }
+
+    ThreadPool::sharedNumThreads() = o.numThreads;
+    BenchmarkController controller(o);
+
+    // the first pass lays out the buffers and warms the caches, it is not measured
+    for (const auto& e : frames) controller.process(e);
+    for (int i = 0; i < PhaseTimer::NUM_PHASES; i++) PhaseTimer::getHistogram((PhaseTimer::Phase)i).reset();
+
+    const int numFrames = frames.size() * o.repeat;
+    AllocationCounter::Scope allocScope;
+    const PhaseTimer::Clock::time_point begin = PhaseTimer::Clock::now();
+    for (int r = 0; r < o.repeat; r++)
+    {
+        for (const auto& e : frames)
+        {
+            PhaseTimer::Scope timer(PhaseTimer::FRAME);
+            controller.process(e);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(PhaseTimer::Clock::now() - begin).count();
+    const unsigned long allocations = allocScope.get();
+
+    const ofPixels& first = frames.front();
+    printf("%d frames (%d x %d), %dx%dx%d, resize ratio %d, %d threads, stages \"%s\"%s%s\n",
+           numFrames, (int)frames.size(), o.repeat, first.getWidth(), first.getHeight(), first.getNumChannels(),
+           o.resizeRatio, ThreadPool::getShared().getNumThreads(), o.stages.c_str(), o.bFull ? ", full" : "",
+           o.bAdaptive ? ", adaptive" : "");
+    printf("%-14s %8s %12s %8s %8s %8s\n", "phase", "calls", "ns/frame", "p50 ms", "p99 ms", "max ms");
+    for (int i = 0; i < PhaseTimer::NUM_PHASES; i++)
+    {
+        const LatencyHistogram::Summary s = PhaseTimer::getHistogram((PhaseTimer::Phase)i).getSummary();
+        if (s.count == 0) continue;
+        printf("%-14s %8llu %12.0f %8.3f %8.3f %8.3f\n", PhaseTimer::getName((PhaseTimer::Phase)i),
+               (unsigned long long)s.count, (double)s.totalNs / numFrames, s.p50, s.p99, s.max);
+    }
+    printf("%.1f frames/s, %.0f ns/frame, %d blobs (%d points) in the last frame\n",
+           numFrames / seconds, seconds * 1e9 / numFrames, controller.getNumBlobs(), controller.getNumPoints());
+    if (AllocationCounter::isEnabled())
+    {
+        printf("%lu allocations on the calling thread (%.2f/frame)\n", allocations, (double)allocations / numFrames);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef COUNT_FRAME_ALLOCATIONS
+
+static __thread unsigned long sThreadAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++sThreadAllocations;
+    void* p = std::malloc(size ? size : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+bool AllocationCounter::isEnabled()
+{
+    return true;
+}
+
+unsigned long AllocationCounter::getThreadCount()
+{
+    return sThreadAllocations;
+}
+
+#else
+
+bool AllocationCounter::isEnabled()
+{
+    return false;
+}
+
+unsigned long AllocationCounter::getThreadCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofMain.h"
+#include "constants.h"
+
+/**
+ *  Counts heap allocations (operator new) made by the calling thread.
+ *  Only active when COUNT_FRAME_ALLOCATIONS is defined in constants.h,
+ *  otherwise every count is 0.
+ */
+namespace AllocationCounter
+{
+    bool isEnabled();
+    unsigned long getThreadCount();
+
+    class Scope
+    {
+        const unsigned long mBegin;
+    public:
+        Scope() : mBegin(getThreadCount()) {}
+        unsigned long get() const { return getThreadCount() - mBegin; }
+    };
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ImageProcessing.hpp"
+#include <stdint.h>
+
+/**
+ *  1 bit per pixel binary image, each row packed into 64-bit words
+ *  (bit i of word k is pixel x = k * 64 + i, padding bits are kept 0).
+ *  Morphology works on whole words: a 3x3 square is a shift in x and an
+ *  AND/OR of the neighbouring rows in y, so 64 pixels cost a few instructions.
+ */
+class BinaryMask
+{
+public:
+    typedef uint64_t word_t;
+    static const int WORD_BITS = 64;
+
+private:
+    vector<word_t>  mWords;
+    vector<word_t>  mScratch;
+    vector<unsigned char> mFlags;   // one row of 0/1 bytes, padded to whole words
+    int             mWidth, mHeight;
+    int             mStride;        // words per row
+    word_t          mLastMask;      // valid bits of the last word of a row
+
+    // 64 bytes of 0/1 -> one word, eight at a time (little endian)
+    static word_t packFlags(const unsigned char* flags)
+    {
+        word_t bits = 0;
+        for (int j = 0; j < 8; ++j)
+        {
+            word_t b;
+            memcpy(&b, flags + j * 8, sizeof(b));
+            bits |= ((b * 0x0102040810204080ULL) >> 56) << (j * 8);
+        }
+        return bits;
+    }
+
+    // 3x3 erosion (bErode) or dilation of rows [y0, y1), outside of them counts as
+    // set for erosion and as clear for dilation so the borders are left untouched
+    void morph3x3(bool bErode, int y0, int y1)
+    {
+        const word_t fill = bErode ? ~(word_t)0 : 0;
+        const word_t pad  = bErode ? ~mLastMask : 0;
+        const int last = mStride - 1;
+
+        // horizontal pass into the scratch rows
+        for (int y = y0; y < y1; ++y)
+        {
+            const word_t* src = &mWords[y * mStride];
+            word_t* dst = &mScratch[y * mStride];
+            word_t prev = fill;
+            word_t cur  = src[0] | (last == 0 ? pad : 0);
+            for (int k = 0; k < mStride; ++k)
+            {
+                const word_t next  = k < last ? (src[k + 1] | (k + 1 == last ? pad : 0)) : fill;
+                const word_t left  = (cur << 1) | (prev >> (WORD_BITS - 1));
+                const word_t right = (cur >> 1) | (next << (WORD_BITS - 1));
+                dst[k] = bErode ? (cur & left & right) : (cur | left | right);
+                prev = cur;
+                cur  = next;
+            }
+        }
+
+        // vertical pass back into the mask
+        for (int y = y0; y < y1; ++y)
+        {
+            const word_t* up   = y > y0     ? &mScratch[(y - 1) * mStride] : NULL;
+            const word_t* mid  = &mScratch[y * mStride];
+            const word_t* down = y < y1 - 1 ? &mScratch[(y + 1) * mStride] : NULL;
+            word_t* dst = &mWords[y * mStride];
+            for (int k = 0; k < mStride; ++k)
+            {
+                const word_t u = up   ? up[k]   : fill;
+                const word_t d = down ? down[k] : fill;
+                dst[k] = bErode ? (u & mid[k] & d) : (u | mid[k] | d);
+            }
+            dst[last] &= mLastMask;
+        }
+    }
+
+public:
+    BinaryMask() : mWidth(0), mHeight(0), mStride(0), mLastMask(0) {}
+
+    void allocate(int w, int h)
+    {
+        mWidth  = w;
+        mHeight = h;
+        mStride = (w + WORD_BITS - 1) / WORD_BITS;
+        const int rem = w % WORD_BITS;
+        mLastMask = rem ? (((word_t)1 << rem) - 1) : ~(word_t)0;
+        mWords.assign(mStride * h, 0);
+        mScratch.assign(mStride * h, 0);
+        mFlags.assign(mStride * WORD_BITS, 0);
+    }
+
+    void allocateIfNeeded(int w, int h)
+    {
+        if (w != mWidth || h != mHeight) allocate(w, h);
+    }
+
+    /// release the memory, isAllocated() is false afterwards
+    void clear()
+    {
+        vector<word_t>().swap(mWords);
+        vector<word_t>().swap(mScratch);
+        vector<unsigned char>().swap(mFlags);
+        mWidth = mHeight = mStride = 0;
+        mLastMask = 0;
+    }
+
+    /// set the bit of every gray pixel that is <= th (ink on paper)
+    void threshold(const ofPixels& gray, int th)
+    {
+        threshold(gray, th, 0, gray.getHeight());
+    }
+
+    /// same, only rows [rowBegin, rowEnd)
+    void threshold(const ofPixels& gray, int th, int rowBegin, int rowEnd)
+    {
+        allocateIfNeeded(gray.getWidth(), gray.getHeight());
+        unsigned char flags[WORD_BITS];
+        for (int y = rowBegin; y < rowEnd; ++y)
+        {
+            const unsigned char* px = gray.getPixels() + y * mWidth;
+            word_t* row = &mWords[y * mStride];
+            for (int k = 0; k < mStride; ++k)
+            {
+                const int x0 = k * WORD_BITS;
+                const int n  = mWidth - x0;
+                if (n >= WORD_BITS)
+                {
+                    for (int i = 0; i < WORD_BITS; ++i) flags[i] = px[x0 + i] <= th;
+                }
+                else
+                {
+                    for (int i = 0; i < WORD_BITS; ++i) flags[i] = i < n && px[x0 + i] <= th;
+                }
+                row[k] = packFlags(flags);
+            }
+        }
+    }
+
+    /**
+     *  Bradley's adaptive threshold: set the bit of every pixel that is more than
+     *  offsetPercent darker than the mean of the (2 * radius + 1)^2 window around it.
+     *  integral is the (w + 1) x (h + 1) summed-area table of gray, see RemapTransform::apply.
+     */
+    void thresholdAdaptive(const ofPixels& gray, const unsigned int* integral, int radius, int offsetPercent)
+    {
+        thresholdAdaptive(gray, integral, radius, offsetPercent, 0, gray.getHeight());
+    }
+
+    void thresholdAdaptive(const ofPixels& gray, const unsigned int* integral, int radius, int offsetPercent,
+                           int rowBegin, int rowEnd)
+    {
+        allocateIfNeeded(gray.getWidth(), gray.getHeight());
+        const int iw = mWidth + 1;
+        const unsigned int scale = 100 - offsetPercent;
+        for (int y = rowBegin; y < rowEnd; ++y)
+        {
+            const unsigned char* px = gray.getPixels() + y * mWidth;
+            const int y0 = MAX(0, y - radius);
+            const int y1 = MIN(mHeight, y + radius + 1);
+            const unsigned int* top = integral + y0 * iw;
+            const unsigned int* bot = integral + y1 * iw;
+            // the window is clipped at the left and right edges only
+            auto clipped = [&](int x)
+            {
+                const int x0 = MAX(0, x - radius);
+                const int x1 = MIN(mWidth, x + radius + 1);
+                const unsigned int sum = bot[x1] - bot[x0] - top[x1] + top[x0];
+                const unsigned int count = (x1 - x0) * (y1 - y0);
+                return px[x] * count * 100 <= sum * scale;
+            };
+            const int xa = MIN(radius, mWidth);
+            const int xb = MAX(xa, mWidth - radius - 1);
+            for (int x = 0; x < xa; ++x)        mFlags[x] = clipped(x);
+            for (int x = xb; x < mWidth; ++x)   mFlags[x] = clipped(x);
+            const unsigned int count100 = (2 * radius + 1) * (y1 - y0) * 100;
+            for (int x = xa; x < xb; ++x)
+            {
+                const unsigned int sum = bot[x + radius + 1] - bot[x - radius] - top[x + radius + 1] + top[x - radius];
+                mFlags[x] = px[x] * count100 <= sum * scale;
+            }
+            word_t* row = &mWords[y * mStride];
+            for (int k = 0; k < mStride; ++k)
+            {
+                row[k] = packFlags(&mFlags[k * WORD_BITS]);
+            }
+        }
+    }
+
+    /**
+     *  Morphology on rows [rowBegin, rowEnd) only, rows outside are not read.
+     *  Each pass can move a pixel by one row, so after n passes the result is
+     *  exact except for the n rows at either end of the range.
+     */
+    void erode(int iterations, int rowBegin, int rowEnd)  { for (int i = 0; i < iterations; ++i) morph3x3(true, rowBegin, rowEnd); }
+    void dilate(int iterations, int rowBegin, int rowEnd) { for (int i = 0; i < iterations; ++i) morph3x3(false, rowBegin, rowEnd); }
+
+    void open(int iterations, int rowBegin, int rowEnd)
+    {
+        erode(iterations, rowBegin, rowEnd);
+        dilate(iterations, rowBegin, rowEnd);
+    }
+
+    void close(int iterations, int rowBegin, int rowEnd)
+    {
+        dilate(iterations, rowBegin, rowEnd);
+        erode(iterations, rowBegin, rowEnd);
+    }
+
+    void erode(int iterations = 1)  { erode(iterations, 0, mHeight); }
+    void dilate(int iterations = 1) { dilate(iterations, 0, mHeight); }
+
+    /// removes specks smaller than the structuring element
+    void open(int iterations = 1)   { open(iterations, 0, mHeight); }
+
+    /// fills pinholes and hairline gaps
+    void close(int iterations = 1)  { close(iterations, 0, mHeight); }
+
+    /// copy rows [rowBegin, rowEnd) of a mask of the same size
+    void copyRows(const BinaryMask& src, int rowBegin, int rowEnd)
+    {
+        allocateIfNeeded(src.getWidth(), src.getHeight());
+        if (rowEnd <= rowBegin) return;
+        memcpy(&mWords[rowBegin * mStride], src.getRow(rowBegin), (rowEnd - rowBegin) * mStride * sizeof(word_t));
+    }
+
+    /// number of set pixels
+    int count() const
+    {
+        int n = 0;
+        for (size_t i = 0; i < mWords.size(); ++i)
+        {
+            n += __builtin_popcountll(mWords[i]);
+        }
+        return n;
+    }
+
+    /// expand to an 8bit image (set = 255, clear = 0)
+    void unpack(ofPixels& dst) const
+    {
+        unpack(dst, 0, mHeight);
+    }
+
+    void unpack(ofPixels& dst, int rowBegin, int rowEnd) const
+    {
+        imp::allocateIfNeeded(dst, mWidth, mHeight, 1);
+        for (int y = rowBegin; y < rowEnd; ++y)
+        {
+            const word_t* row = &mWords[y * mStride];
+            unsigned char* px = dst.getPixels() + y * mWidth;
+            for (int x = 0; x < mWidth; ++x)
+            {
+                px[x] = -(unsigned char)((row[x / WORD_BITS] >> (x % WORD_BITS)) & 1);
+            }
+        }
+    }
+
+    bool get(int x, int y) const
+    {
+        return (mWords[y * mStride + x / WORD_BITS] >> (x % WORD_BITS)) & 1;
+    }
+
+    const word_t* getRow(int y) const { return &mWords[y * mStride]; }
+    bool isAllocated() const { return mWords.empty() == false; }
+    int getWidth() const  { return mWidth; }
+    int getHeight() const { return mHeight; }
+    int getStride() const { return mStride; }
+};
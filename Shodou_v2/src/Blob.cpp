@@ -6,6 +6,11 @@ Blob::Blob(const ofxCvBlob& blob, float w, float h, float offsetW)
     setup(blob, w, h, offsetW);
 }
 
+Blob::Blob(const BlobView& blob)
+{
+    setup(blob);
+}
+
 Blob::Blob(const Blob* o)
 {
     setup(*o, 1, 1, o->offsetW);
@@ -33,6 +38,27 @@ void Blob::setup(const ofxCvBlob& blob, float w, float h, float offsetW)
     this->offsetW = offsetW;
 }
 
+void Blob::setup(const BlobView& blob)
+{
+    ofxCvBlob::hole          = blob.isHole();
+    ofxCvBlob::nPts          = blob.getNumPoints();
+    ofxCvBlob::length        = blob.getLength();
+    
+    // already normalized
+    const float* pts = blob.getPoints();
+    ofxCvBlob::pts.resize(nPts);
+    for (int i = 0; i < nPts; i++)
+    {
+        ofxCvBlob::pts[i].set(pts[i * 2], pts[i * 2 + 1]);
+    }
+    ofxCvBlob::boundingRect = blob.getBoundingRect();
+    ofxCvBlob::centroid = blob.getCentroid();
+    ofxCvBlob::area = blob.getArea();
+    this->width = 1;
+    this->height = 1;
+    this->offsetW = 0;
+}
+
 void Blob::draw(float x, float y)
 {
     ofNoFill();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ofxCvContourFinder.h"
+#include "BlobStore.h"
 
 class Blob : public ofxCvBlob
 {
@@ -11,24 +12,25 @@ public:
     
 public:
     Blob(const ofxCvBlob& blob, float w, float h, float offsetW = 0);
+    Blob(const BlobView& blob);
     Blob(const Blob* o);
     void setup(const ofxCvBlob& blob, float w, float h, float offsetW = 0);
+    void setup(const BlobView& blob);
     void draw(float x = 0, float y = 0);
 };
 
 typedef ofPtr<Blob>         BLOB_TYPE;
-typedef deque<BLOB_TYPE>    BLOBS_TYPE;
 
 
 
 class BlobNoteEvent : public ofEventArgs
 {
 public:
-    const BLOB_TYPE     &blobPtr;
+    const BlobView      blob;       // copy it into a Blob to keep it
     const int           channel;
     
-    BlobNoteEvent(const BLOB_TYPE& blobPtr, const int channel)
-    : blobPtr(blobPtr)
+    BlobNoteEvent(const BlobView& blob, const int channel)
+    : blob(blob)
     , channel(channel)
     {}
 };
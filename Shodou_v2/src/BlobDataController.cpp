@@ -24,26 +24,20 @@ void VerticalSequencer::update(float tick)
     mPos += tick;
 }
 
-void VerticalSequencer::emit(const BLOBS_TYPE& blobs)
+void VerticalSequencer::emit(const BlobStore& blobs, const BlobRowIndex& rows)
 {
     float y1 = ofMap(mLastPos, 0, mLoopTime, 0, mHeight);
     float y2 = ofMap(mPos,     0, mLoopTime, 0, mHeight);
     
-    for (const auto& e : blobs)
+    // only the points of the strokes between the last and the current position
+    rows.forEachInBand(y1, y2, [&](const BlobRowIndex::Entry& p)
     {
-        if (e->hole) continue;
-        
-        for (const auto& p : e->pts)
-        {
-            if (p.y > y1 && p.y <= y2)
-            {
-                int note = ofMap(p.x, 0, mWidth, 24, 96, true);
-                int velo = ofMap(e->area, 0, 0.01, 20, 90, true);
-                int pan  = ofMap(e->centroid.x, 0, mWidth, 0, 127, true);
-                Sequencer::sendNote(note, velo, 0.2, mChannel, pan);
-            }
-        }
-    }
+        const BlobView e = blobs[p.blob];
+        int note = ofMap(p.x, 0, mWidth, 24, 96, true);
+        int velo = ofMap(e.getArea(), 0, 0.01, 20, 90, true);
+        int pan  = ofMap(e.getCentroid().x, 0, mWidth, 0, 127, true);
+        Sequencer::sendNote(note, velo, 0.2, mChannel, pan);
+    });
 }
 
 void VerticalSequencer::draw(int x, int y, int w, int h)
@@ -72,6 +66,7 @@ OrdinalSequencer::OrdinalSequencer(float maxDurationToNext, bool loop, int chann
 void OrdinalSequencer::setup()
 {
     mCurrentIndex = 0;
+    mCurrentId = -1;
     mCount = 0;
     mDurationToNext = 0;
     bPlay = true;
@@ -91,14 +86,17 @@ void OrdinalSequencer::update(float tick)
     }
 }
 
-void OrdinalSequencer::emit(const BLOBS_TYPE& blobs)
+void OrdinalSequencer::emit(const BlobStore& blobs, const BlobRowIndex& rows)
 {
     if (bPlay)
     {
+        // the blob that is due moves in the order when the blobs are rebuilt
+        const BlobView current = blobs.find(mCurrentId);
+        if (current.isValid()) mCurrentIndex = current.getIndex();
         if (blobs.empty() || mCurrentIndex >= blobs.size()) return;
         // send midi
         Sequencer::sendNote(blobs[mCurrentIndex], mMaxDurationToNext, mChannel);
-        sequencerAnimation::manager.createInstance<sequencerAnimation::BlobDrawr>(&blobs[mCurrentIndex], mCol)->play(mDurationToNext);
+        sequencerAnimation::manager.createInstance<sequencerAnimation::BlobDrawr>(&blobs, blobs[mCurrentIndex].getId(), mCol)->play(mDurationToNext);
         // notify event
         BlobNoteEvent event(blobs[mCurrentIndex], mChannel);
         ofNotifyEvent(mBlobNoteEvent, event, this);
@@ -122,16 +120,17 @@ void OrdinalSequencer::emit(const BLOBS_TYPE& blobs)
             }
         }
         else {
-            mLastPos.set(blobs[mCurrentIndex]->centroid);
-            mTargetPos.set(blobs[mCurrentIndex + 1]->centroid);
-            float dist = ofDist(blobs[mCurrentIndex  ]->centroid.x, blobs[mCurrentIndex  ]->centroid.y,
-                                blobs[mCurrentIndex+1]->centroid.x, blobs[mCurrentIndex+1]->centroid.y);
+            mLastPos.set(blobs[mCurrentIndex].getCentroid());
+            mTargetPos.set(blobs[mCurrentIndex + 1].getCentroid());
+            float dist = ofDist(blobs[mCurrentIndex  ].getCentroid().x, blobs[mCurrentIndex  ].getCentroid().y,
+                                blobs[mCurrentIndex+1].getCentroid().x, blobs[mCurrentIndex+1].getCentroid().y);
             mDurationToNext = mMaxDurationToNext;
         }
         
         // reset
         bPlay = false;
         mCurrentIndex++;
+        mCurrentId = blobs[mCurrentIndex].getId();
         mCount = 0;
     }
 }
@@ -164,6 +163,7 @@ void RandomSequencer::setup()
 {
     mCount = 0;
     mCurrentIndex = 0;
+    mCurrentId = -1;
     mDurationToNext = 0;
     bPlay = true;
     mLastPos.set(0, 0);
@@ -182,31 +182,34 @@ void RandomSequencer::update(float tick)
     }
 }
 
-void RandomSequencer::emit(const BLOBS_TYPE& blobs)
+void RandomSequencer::emit(const BlobStore& blobs, const BlobRowIndex& rows)
 {
     if (bPlay)
     {
         int nextIndex = ofRandom(blobs.size());
+        const BlobView current = blobs.find(mCurrentId);
+        if (current.isValid()) mCurrentIndex = current.getIndex();
         if (blobs.empty() || mCurrentIndex >= blobs.size()) return;
         
         // send midi
         Sequencer::sendNote(blobs[mCurrentIndex], mMaxDurationToNext, mChannel);
-        sequencerAnimation::manager.createInstance<sequencerAnimation::BlobDrawr>(&blobs[mCurrentIndex], mCol)->play(mDurationToNext);
+        sequencerAnimation::manager.createInstance<sequencerAnimation::BlobDrawr>(&blobs, blobs[mCurrentIndex].getId(), mCol)->play(mDurationToNext);
         
         // notify event
         BlobNoteEvent event(blobs[mCurrentIndex], mChannel);
         ofNotifyEvent(mBlobNoteEvent, event, this);
         
         // set duration to next
-        mLastPos.set(blobs[mCurrentIndex]->centroid);
-        mTargetPos.set(blobs[nextIndex]->centroid);
-        float dist = ofDist(blobs[mCurrentIndex  ]->centroid.x, blobs[mCurrentIndex  ]->centroid.y,
-                            blobs[nextIndex]->centroid.x, blobs[nextIndex]->centroid.y);
+        mLastPos.set(blobs[mCurrentIndex].getCentroid());
+        mTargetPos.set(blobs[nextIndex].getCentroid());
+        float dist = ofDist(blobs[mCurrentIndex  ].getCentroid().x, blobs[mCurrentIndex  ].getCentroid().y,
+                            blobs[nextIndex].getCentroid().x, blobs[nextIndex].getCentroid().y);
         mDurationToNext = mMaxDurationToNext;
         
         // reset
         bPlay = false;
         mCurrentIndex = nextIndex;
+        mCurrentId = blobs[nextIndex].getId();
         mCount = 0;
     }
 }
@@ -229,7 +232,7 @@ void RandomSequencer::draw(int x, int y, int w, int h)
 //
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
-BlobsDataController::BlobsDataController()
+BlobsDataController::BlobsDataController() : bRowIndexDirty(true), bSimplificationChanged(false)
 {
     float pct = 1.8;
     mSeq.push_back(new VerticalSequencer(4 * pct, 1, ofColor(90)));
@@ -257,18 +260,32 @@ void BlobsDataController::setupMidi(const string& senderPoitName, const string&
 void BlobsDataController::update()
 {
     const float tick = ofGetLastFrameTime();
+    if (bRowIndexDirty)
+    {
+        mRowIndex.build(mBlobs);
+        bRowIndexDirty = false;
+    }
     for (auto& e : mSeq)
     {
         if (e->isPlaying())
         {
             e->setSize(1, 1);
             e->update(tick);
-            e->emit(mBlobs);
+            e->emit(mBlobs, mRowIndex);
         }
     }
     sequencerAnimation::manager.update();
 }
 
+static void addVertices(const BlobView& blob, float w, float h)
+{
+    const float* pts = blob.getPoints();
+    for (int i = 0; i < blob.getNumPoints(); i++)
+    {
+        ofVertex(pts[i * 2] * w, pts[i * 2 + 1] * h);
+    }
+}
+
 void BlobsDataController::draw(int x, int y, int w, int h)
 {
     ofPushStyle();
@@ -276,29 +293,57 @@ void BlobsDataController::draw(int x, int y, int w, int h)
     ofPushMatrix();
     ofTranslate(x, y);
     
+    // strokes filled around their holes
+    ofFill();
+    ofSetColor(0, 255, 0, 40);
+    for (int i = 0; i < mBlobs.size(); i++)
+    {
+        const BlobView stroke = mBlobs[i];
+        if (stroke.isHole()) continue;
+        ofBeginShape();
+        addVertices(stroke, w, h);
+        for (BlobView hole = stroke.getFirstChild(); hole.isValid(); hole = hole.getNextSibling())
+        {
+            ofNextContour(true);
+            addVertices(hole, w, h);
+        }
+        ofEndShape(true);
+    }
+    
+    ofSetColor(255, 0, 0);
     ofNoFill();
-    for( int i=0; i<(int)mBlobs.size(); i++ )
+    for( int i=0; i<mBlobs.size(); i++ )
     {
-        ofRect(mBlobs[i]->boundingRect.x * w,
-               mBlobs[i]->boundingRect.y * h,
-               mBlobs[i]->boundingRect.width * w,
-               mBlobs[i]->boundingRect.height * h);
+        const ofRectangle& r = mBlobs[i].getBoundingRect();
+        ofRect(r.x * w, r.y * h, r.width * w, r.height * h);
     }
     
     
-    for( int i=0; i<(int)mBlobs.size(); i++ )
+    for( int i=0; i<mBlobs.size(); i++ )
     {
         ofNoFill();
-        mBlobs[i]->hole ? ofSetColor(0, 0, 255) : ofSetColor(0, 255, 0);
+        mBlobs[i].isHole() ? ofSetColor(0, 0, 255) : ofSetColor(0, 255, 0);
         ofBeginShape();
-        for( int j=0; j<mBlobs[i]->nPts; j++ )
+        const float* pts = mBlobs[i].getPoints();
+        for( int j=0; j<mBlobs[i].getNumPoints(); j++ )
         {
-            ofVertex( mBlobs[i]->pts[j].x * w, mBlobs[i]->pts[j].y * h );
+            ofVertex( pts[j * 2] * w, pts[j * 2 + 1] * h );
         }
         ofEndShape();
         
     }
     
+    // selected blobs
+    ofSetColor(255, 255, 0);
+    ofSetLineWidth(3);
+    for (int i = 0; i < mSelection.size(); i++)
+    {
+        ofBeginShape();
+        addVertices(mSelection[i], w, h);
+        ofEndShape(true);
+    }
+    ofSetLineWidth(1);
+    
     sequencerAnimation::manager.draw();
     
     ofPopMatrix();
@@ -339,26 +384,68 @@ void BlobsDataController::sequencerTogglePlay(int sequencerIndex)
 
 void BlobsDataController::addBlob(ofxCvBlob& cvBlob, float w, float h, float offsetW)
 {
-    mBlobs.push_back(BLOB_TYPE(new Blob(cvBlob, w, h, offsetW)));
+    mBlobs.setId(mBlobs.add(cvBlob, w, h, offsetW), mTracker.newId());
+    bRowIndexDirty = true;
+}
+
+void BlobsDataController::addBlob(const ContourSet& contours, int index, float w, float h, float offsetW)
+{
+    mBlobs.setId(mBlobs.add(contours, index, w, h, offsetW), mTracker.newId());
+    bRowIndexDirty = true;
+}
+
+void BlobsDataController::addBlob(const BlobView& blob)
+{
+    mBlobs.add(blob);
+    bRowIndexDirty = true;
+}
+
+void BlobsDataController::selectBlobTree(const BlobView& blob)
+{
+    if (mSelection.find(blob.getId()).isValid()) return;
+    mSelection.addTree(blob);
+}
+
+void BlobsDataController::clearSelection()
+{
+    mSelection.clear();
+}
+
+const BlobStore& BlobsDataController::getSelectionRef() const
+{
+    return mSelection;
 }
 
 void BlobsDataController::removeBlob()
 {
-    if (!mBlobs.empty())
-    {
-        mBlobs.pop_back();
-    }
+    mBlobs.pop_back();
+    bRowIndexDirty = true;
 }
 
 void BlobsDataController::clearBlobs()
 {
-    if (!mBlobs.empty())
-    {
-        mBlobs.clear();
-    }
+    mBlobs.clear();
+    bRowIndexDirty = true;
+}
+
+void BlobsDataController::updateBlobs(const ContourSet& contours, bool bCarriedOver)
+{
+    // the stores swap, so a rebuild reuses the memory of the frame before
+    std::swap(mBlobs, mPrevBlobs);
+    // blobs of another tolerance are not carried over
+    mTracker.update(contours, bCarriedOver && bSimplificationChanged == false, mPrevBlobs, mBlobs);
+    bSimplificationChanged = false;
+    bRowIndexDirty = true;
+}
+
+void BlobsDataController::setSimplification(float tolerance, bool bKeepOriginalPoints)
+{
+    mBlobs.setSimplification(tolerance, bKeepOriginalPoints);
+    mPrevBlobs.setSimplification(tolerance, bKeepOriginalPoints);
+    bSimplificationChanged = true;
 }
 
-const BLOBS_TYPE& BlobsDataController::getBlobsRef() const
+const BlobStore& BlobsDataController::getBlobsRef() const
 {
     return mBlobs;
 }
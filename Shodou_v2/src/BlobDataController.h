@@ -4,6 +4,8 @@
 #include "utils.h"
 #include "ofxOpenCv.h"
 #include "Blob.h"
+#include "BlobTracker.h"
+#include "BlobRowIndex.hpp"
 #include "ofxAnimationPrimitives.h"
 #include "MidiSenderController.hpp"
 #include "MIdiReceiverController.hpp"
@@ -20,22 +22,23 @@ namespace sequencerAnimation
 {
     class BlobDrawr : public ofxAnimationPrimitives::Instance
     {
-        const BLOB_TYPE  *mBlob;
+        const BlobStore *mBlobs;    // the blobs of the controller, rebuilt every frame
+        int mId;
         ofColor mCol;
     public:
-        BlobDrawr(const BLOB_TYPE *blob, ofColor col) : mBlob(blob), mCol(col) {}
+        BlobDrawr(const BlobStore *blobs, int id, ofColor col) : mBlobs(blobs), mId(id), mCol(col) {}
         void draw()
         {
             // FIXME: tessaration bug
-            //            assert(mBlob != NULL);
-            //            if (mBlob == NULL) return;
+            //            const BlobView mBlob = mBlobs->find(mId);
+            //            if (mBlob.isValid() == false) return;
             //            ofSetColor(mCol, getLife() * 255);
             //            ofFill();
             //            ofBeginShape();
-            //            for (const auto& p : mBlob->pts)
+            //            for (int i = 0; i < mBlob.getNumPoints(); i++)
             //            {
             //                // TODO: define width and height
-            //                ofVertex(p.x * ofGetWidth(), p.y * ofGetHeight() * 0.5);
+            //                ofVertex(mBlob.getPoint(i).x * ofGetWidth(), mBlob.getPoint(i).y * ofGetHeight() * 0.5);
             //            }
             //            ofEndShape();
         }
@@ -62,7 +65,7 @@ public:
     
     virtual void setup(){};
     virtual void update(float tick){};
-    virtual void emit(const BLOBS_TYPE& blobs){};
+    virtual void emit(const BlobStore& blobs, const BlobRowIndex& rows){};
     virtual void draw(int x, int y, int w, int h){}
     
     void play(){ bPlaying = true; }
@@ -74,13 +77,13 @@ public:
     
     // send midi messages
     
-    static void sendNote(const BLOB_TYPE& blob, float duration, int channel)
+    static void sendNote(const BlobView& blob, float duration, int channel)
     {
-        int note = ofMap(blob->area, 0, 0.01, 64, 24, true);
+        int note = ofMap(blob.getArea(), 0, 0.01, 64, 24, true);
         int velo = ofRandom(90, 110);
         // option
-        int pan  = ofMap(blob->centroid.x, 0, 1, 0, 127, true);
-        int area = ofMap(blob->area, 0, 0.01, 0, 127, true);
+        int pan  = ofMap(blob.getCentroid().x, 0, 1, 0, 127, true);
+        int area = ofMap(blob.getArea(), 0, 0.01, 0, 127, true);
                 
         MIDI_SENDER->makeNote(note, velo, channel, duration);
         MIDI_SENDER->ctlOut(10, pan, channel);
@@ -109,7 +112,7 @@ public:
     VerticalSequencer(float loopTime, int channel, ofColor col);
     void setup();
     void update(float tick);
-    void emit(const BLOBS_TYPE& blobs);
+    void emit(const BlobStore& blobs, const BlobRowIndex& rows);
     void draw(int x, int y, int w, int h);
 };
 
@@ -119,6 +122,7 @@ class OrdinalSequencer : public Sequencer
     float mCount;
     float mDurationToNext;
     int mCurrentIndex;
+    int mCurrentId;     // blob of mCurrentIndex, followed when the blobs are rebuilt
     bool bPlay;
     float mMaxDurationToNext;
     int mChannel;
@@ -130,7 +134,7 @@ public:
     OrdinalSequencer(float maxDurationToNext, bool loop, int channel, ofColor col);
     void setup();
     void update(float tick);
-    void emit(const BLOBS_TYPE& blobs);
+    void emit(const BlobStore& blobs, const BlobRowIndex& rows);
     void draw(int x, int y, int w, int h);
 };
 
@@ -140,6 +144,7 @@ class RandomSequencer : public Sequencer
     float mCount;
     float mDurationToNext;
     int mCurrentIndex;
+    int mCurrentId;
     bool bPlay;
     bool bLoop;
     float mMaxDurationToNext;
@@ -151,7 +156,7 @@ public:
     RandomSequencer(float maxDurationToNext, bool loop, int channel, ofColor col);
     void setup();
     void update(float tick);
-    void emit(const BLOBS_TYPE& blobs);
+    void emit(const BlobStore& blobs, const BlobRowIndex& rows);
     void draw(int x, int y, int w, int h);
 };
 
@@ -164,7 +169,13 @@ public:
 
 class BlobsDataController
 {
-    BLOBS_TYPE mBlobs;
+    BlobStore mBlobs;
+    BlobStore mPrevBlobs;
+    BlobStore mSelection;       // strokes picked by hand, with their tracked ids
+    BlobTracker mTracker;
+    BlobRowIndex mRowIndex;
+    bool bRowIndexDirty;
+    bool bSimplificationChanged;
     
     VerticalSequencer*  mVertSeq;
     OrdinalSequencer*   mOrdinalSeq;
@@ -184,9 +195,19 @@ public:
     void sequencerStop(int sequencerIndex);
     void sequencerTogglePlay(int sequencerIndex);
     void addBlob(ofxCvBlob& cvBlob, float w, float h, float offsetW);
+    void addBlob(const ContourSet& contours, int index, float w, float h, float offsetW);
+    void addBlob(const BlobView& blob);
+    /// copies blob with its holes and the islands in them into the selection, once per id
+    void selectBlobTree(const BlobView& blob);
+    void clearSelection();
+    const BlobStore& getSelectionRef() const;
     void removeBlob();
     void clearBlobs();
-    const BLOBS_TYPE& getBlobsRef() const;
+    /// rebuilds the blobs from the contours of a frame, a blob keeps its id while its stroke is seen
+    void updateBlobs(const ContourSet& contours, bool bCarriedOver);
+    /// contours are simplified to this tolerance (pixels of the contours, 0 keeps every point) from the next rebuild
+    void setSimplification(float tolerance, bool bKeepOriginalPoints = false);
+    const BlobStore& getBlobsRef() const;
     
     void drawSeq(int index, int x, int y, int w, int h);
     void drawSeqAll(int x, int y, int w, int h);
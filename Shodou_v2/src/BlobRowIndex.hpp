@@ -0,0 +1,75 @@
+#pragma once
+
+#include "BlobStore.h"
+
+/**
+ *  The contour points of the strokes (holes are left out) of a BlobStore,
+ *  bucketed by row with a counting sort, so a scan line only visits the rows
+ *  of its band instead of every point of every blob. Build it once after the
+ *  blobs changed; it keeps its memory from one build to the next.
+ */
+class BlobRowIndex
+{
+public:
+    struct Entry
+    {
+        float   x, y;
+        int     blob;
+    };
+
+private:
+    static const int NUM_ROWS = 256;    // over the normalized height
+
+    vector<int>     mRowBegin;          // NUM_ROWS + 1 offsets into mEntries
+    vector<int>     mFill;
+    vector<Entry>   mEntries;
+
+    static int getRow(float y) { return ofClamp((int)(y * NUM_ROWS), 0, NUM_ROWS - 1); }
+
+public:
+    BlobRowIndex() : mRowBegin(NUM_ROWS + 1, 0), mFill(NUM_ROWS) {}
+
+    void build(const BlobStore& blobs)
+    {
+        std::fill(mRowBegin.begin(), mRowBegin.end(), 0);
+        for (int i = 0; i < blobs.size(); i++)
+        {
+            const BlobView b = blobs[i];
+            if (b.isHole()) continue;
+            const float* pts = b.getPoints();
+            for (int j = 0; j < b.getNumPoints(); j++) mRowBegin[getRow(pts[j * 2 + 1]) + 1]++;
+        }
+        for (int r = 0; r < NUM_ROWS; r++) mRowBegin[r + 1] += mRowBegin[r];
+
+        mEntries.resize(mRowBegin[NUM_ROWS]);
+        std::copy(mRowBegin.begin(), mRowBegin.end() - 1, mFill.begin());
+        for (int i = 0; i < blobs.size(); i++)
+        {
+            const BlobView b = blobs[i];
+            if (b.isHole()) continue;
+            const float* pts = b.getPoints();
+            for (int j = 0; j < b.getNumPoints(); j++)
+            {
+                Entry& e = mEntries[mFill[getRow(pts[j * 2 + 1])]++];
+                e.x = pts[j * 2];
+                e.y = pts[j * 2 + 1];
+                e.blob = i;
+            }
+        }
+    }
+
+    /// calls f(entry) for the points with y1 < y <= y2
+    template<typename F>
+    void forEachInBand(float y1, float y2, F f) const
+    {
+        if (y2 <= y1) return;
+        const int end = mRowBegin[getRow(y2) + 1];
+        for (int k = mRowBegin[getRow(y1)]; k < end; k++)
+        {
+            const Entry& e = mEntries[k];
+            if (e.y > y1 && e.y <= y2) f(e);
+        }
+    }
+
+    int size() const { return mEntries.size(); }
+};
@@ -0,0 +1,256 @@
+#include "BlobStore.h"
+
+int BlobStore::push(const ofPoint& centroid, float area, float length, const ofRectangle& rect, bool hole, int nPts)
+{
+    mIds.push_back(-1);
+    mCentroids.push_back(centroid);
+    mAreas.push_back(area);
+    mLengths.push_back(length);
+    mBoundingRects.push_back(rect);
+    mHoles.push_back(hole);
+    mPointBegin.push_back(mPoints.size() / 2);
+    mNumPoints.push_back(nPts);
+    mPoints.resize(mPoints.size() + nPts * 2);
+    mOriginalBegin.push_back(-1);
+    mNumOriginalPoints.push_back(0);
+    mParents.push_back(-1);
+    mFirstChild.push_back(-1);
+    mNextSibling.push_back(-1);
+    return size() - 1;
+}
+
+void BlobStore::setSimplification(float tolerance, bool bKeepOriginalPoints)
+{
+    mTolerance = MAX(tolerance, 0);
+    bKeepOriginal = bKeepOriginalPoints;
+}
+
+int BlobStore::simplify(const float* pts, int nPts, int stride)
+{
+    mKeep.assign(nPts, 1);
+    if (mTolerance <= 0 || nPts < 4) return nPts;
+
+    // Douglas-Peucker on the closed contour, split at the point farthest from the first one
+    auto point = [&](int j) { return pts + (j % nPts) * stride; };
+    int far = 0;
+    float farDist = -1;
+    for (int j = 1; j < nPts; j++)
+    {
+        const float dx = point(j)[0] - pts[0];
+        const float dy = point(j)[1] - pts[1];
+        if (dx * dx + dy * dy > farDist)
+        {
+            far = j;
+            farDist = dx * dx + dy * dy;
+        }
+    }
+    std::fill(mKeep.begin(), mKeep.end(), 0);
+    mKeep[0] = mKeep[far] = 1;
+    mSpans.clear();
+    mSpans.push_back(make_pair(0, far));
+    mSpans.push_back(make_pair(far, nPts));
+
+    const float tolerance2 = mTolerance * mTolerance;
+    while (mSpans.empty() == false)
+    {
+        const int a = mSpans.back().first;
+        const int b = mSpans.back().second;
+        mSpans.pop_back();
+        if (b - a < 2) continue;
+
+        // the point farthest from the segment a-b
+        const float* pa = point(a);
+        const float* pb = point(b);
+        const float sx = pb[0] - pa[0];
+        const float sy = pb[1] - pa[1];
+        const float len2 = sx * sx + sy * sy;
+        int best = -1;
+        float bestDist = tolerance2;
+        for (int j = a + 1; j < b; j++)
+        {
+            const float* p = point(j);
+            float dx = p[0] - pa[0];
+            float dy = p[1] - pa[1];
+            if (len2 > 0)
+            {
+                const float t = ofClamp((dx * sx + dy * sy) / len2, 0, 1);
+                dx -= t * sx;
+                dy -= t * sy;
+            }
+            if (dx * dx + dy * dy > bestDist)
+            {
+                best = j;
+                bestDist = dx * dx + dy * dy;
+            }
+        }
+        if (best < 0) continue;
+        mKeep[best] = 1;
+        mSpans.push_back(make_pair(a, best));
+        mSpans.push_back(make_pair(best, b));
+    }
+    return std::count(mKeep.begin(), mKeep.end(), 1);
+}
+
+void BlobStore::keepOriginal(int i, const float* pts, int nPts, int stride, float w, float h, float offsetW)
+{
+    mOriginalBegin[i] = mOriginalPoints.size() / 2;
+    mNumOriginalPoints[i] = nPts;
+    mOriginalPoints.resize(mOriginalPoints.size() + nPts * 2);
+    float* dst = &mOriginalPoints[mOriginalBegin[i] * 2];
+    for (int j = 0; j < nPts; j++)
+    {
+        dst[j * 2]     = (pts[j * stride] + offsetW) / w;
+        dst[j * 2 + 1] = pts[j * stride + 1] / h;
+    }
+}
+
+int BlobStore::add(const ContourSet& contours, int index, float w, float h, float offsetW)
+{
+    const Contour& c = contours[index];
+    const float* src = contours.getPoints(c);
+    const int nPts = simplify(src, c.nPts, 2);
+    const ofRectangle rect((c.boundingRect.getX() + offsetW) / w, c.boundingRect.getY() / h,
+                           c.boundingRect.getWidth() / w, c.boundingRect.getHeight() / h);
+    const int i = push(ofPoint((c.centroid.x + offsetW) / w, c.centroid.y / h), c.area / (w * h), c.length,
+                       rect, c.hole, nPts);
+
+    // set value with normalize
+    float* dst = &mPoints[mPointBegin[i] * 2];
+    for (int j = 0; j < c.nPts; j++)
+    {
+        if (mKeep[j] == false) continue;
+        dst[0] = (src[j * 2] + offsetW) / w;
+        dst[1] = src[j * 2 + 1] / h;
+        dst += 2;
+    }
+    if (bKeepOriginal && nPts < c.nPts) keepOriginal(i, src, c.nPts, 2, w, h, offsetW);
+    return i;
+}
+
+int BlobStore::add(const ofxCvBlob& blob, float w, float h, float offsetW)
+{
+    const ofRectangle rect((blob.boundingRect.getX() + offsetW) / w, blob.boundingRect.getY() / h,
+                           blob.boundingRect.getWidth() / w, blob.boundingRect.getHeight() / h);
+    const int nTraced = blob.pts.size();
+    const float* src = nTraced > 0 ? &blob.pts[0].x : NULL;
+    const int stride = sizeof(ofPoint) / sizeof(float);
+    const int nPts = simplify(src, nTraced, stride);
+    const int i = push(ofPoint((blob.centroid.x + offsetW) / w, blob.centroid.y / h), blob.area / (w * h), blob.length,
+                       rect, blob.hole, nPts);
+
+    // set value with normalize
+    float* dst = &mPoints[mPointBegin[i] * 2];
+    for (int j = 0; j < nTraced; j++)
+    {
+        if (mKeep[j] == false) continue;
+        dst[0] = (blob.pts[j].x + offsetW) / w;
+        dst[1] = blob.pts[j].y / h;
+        dst += 2;
+    }
+    if (bKeepOriginal && nPts < nTraced) keepOriginal(i, src, nTraced, stride, w, h, offsetW);
+    return i;
+}
+
+int BlobStore::add(const BlobView& blob)
+{
+    const int nPts = blob.getNumPoints();
+    const int i = push(blob.getCentroid(), blob.getArea(), blob.getLength(), blob.getBoundingRect(), blob.isHole(), nPts);
+    // the source may be this store, its points are read after the resize
+    const float* src = blob.getPoints();
+    std::copy(src, src + nPts * 2, mPoints.begin() + mPointBegin[i] * 2);
+    mIds[i] = blob.getId();
+    if (blob.getOriginalPoints() != blob.getPoints())
+    {
+        const int nOriginal = blob.getNumOriginalPoints();
+        mOriginalBegin[i] = mOriginalPoints.size() / 2;
+        mNumOriginalPoints[i] = nOriginal;
+        mOriginalPoints.resize(mOriginalPoints.size() + nOriginal * 2);
+        const float* original = blob.getOriginalPoints();
+        std::copy(original, original + nOriginal * 2, mOriginalPoints.begin() + mOriginalBegin[i] * 2);
+    }
+    return i;
+}
+
+void BlobStore::setParent(int i, int parent)
+{
+    mParents[i] = parent;
+    if (parent < 0) return;
+    mNextSibling[i] = mFirstChild[parent];
+    mFirstChild[parent] = i;
+}
+
+int BlobStore::addTree(const BlobView& blob)
+{
+    const int i = add(blob);
+    for (BlobView child = blob.getFirstChild(); child.isValid(); child = child.getNextSibling())
+    {
+        setParent(addTree(child), i);
+    }
+    return i;
+}
+
+void BlobStore::pop_back()
+{
+    if (empty()) return;
+
+    // the children become top level, and the blob leaves its parent
+    const int last = size() - 1;
+    for (int c = mFirstChild[last]; c >= 0; )
+    {
+        const int next = mNextSibling[c];
+        mParents[c] = -1;
+        mNextSibling[c] = -1;
+        c = next;
+    }
+    const int parent = mParents[last];
+    if (parent >= 0)
+    {
+        int* link = &mFirstChild[parent];
+        while (*link != last) link = &mNextSibling[*link];
+        *link = mNextSibling[last];
+    }
+    mParents.pop_back();
+    mFirstChild.pop_back();
+    mNextSibling.pop_back();
+    mPoints.resize(mPointBegin.back() * 2);
+    if (mOriginalBegin.back() >= 0) mOriginalPoints.resize(mOriginalBegin.back() * 2);
+    mOriginalBegin.pop_back();
+    mNumOriginalPoints.pop_back();
+    mIds.pop_back();
+    mCentroids.pop_back();
+    mAreas.pop_back();
+    mLengths.pop_back();
+    mBoundingRects.pop_back();
+    mHoles.pop_back();
+    mPointBegin.pop_back();
+    mNumPoints.pop_back();
+}
+
+void BlobStore::clear()
+{
+    mIds.clear();
+    mCentroids.clear();
+    mAreas.clear();
+    mLengths.clear();
+    mBoundingRects.clear();
+    mHoles.clear();
+    mPointBegin.clear();
+    mNumPoints.clear();
+    mPoints.clear();
+    mOriginalBegin.clear();
+    mNumOriginalPoints.clear();
+    mOriginalPoints.clear();
+    mParents.clear();
+    mFirstChild.clear();
+    mNextSibling.clear();
+}
+
+BlobView BlobStore::find(int id) const
+{
+    if (id < 0) return BlobView();
+    for (int i = 0; i < size(); i++)
+    {
+        if (mIds[i] == id) return BlobView(this, i);
+    }
+    return BlobView();
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCvContourFinder.h"
+#include "ContourTracer.h"
+
+class BlobStore;
+
+/**
+ *  One blob of a BlobStore: the store and an index, cheap to pass by value.
+ *  Coordinates are normalized to the source image like Blob. A view is valid
+ *  until the store is cleared, copy the blob into a Blob to keep it longer.
+ */
+class BlobView
+{
+    const BlobStore*    mStore;
+    int                 mIndex;
+
+public:
+    BlobView() : mStore(NULL), mIndex(-1) {}
+    BlobView(const BlobStore* store, int index) : mStore(store), mIndex(index) {}
+
+    bool isValid() const                    { return mStore != NULL; }
+    int getIndex() const                    { return mIndex; }
+    inline int getId() const;
+
+    inline const ofPoint& getCentroid() const;
+    inline float getArea() const;
+    inline float getLength() const;
+    inline const ofRectangle& getBoundingRect() const;
+    inline bool isHole() const;
+    inline int getNumPoints() const;
+    /// (x, y) pairs
+    inline const float* getPoints() const;
+    inline ofPoint getPoint(int i) const;
+    /// the traced points before simplification, the same as getPoints() unless they were kept
+    inline int getNumOriginalPoints() const;
+    inline const float* getOriginalPoints() const;
+
+    // containment tree: a stroke holds its holes, a hole the islands in it
+    inline BlobView getParent() const;
+    inline BlobView getFirstChild() const;
+    inline BlobView getNextSibling() const;
+};
+
+
+/**
+ *  The blobs of one frame in parallel arrays, with the points of all of them
+ *  in one flat (x, y) float array, so sequencers and renderers that scan
+ *  every blob read contiguous memory. Clearing keeps the memory, so a store
+ *  that is refilled every frame stops allocating once it has seen the
+ *  largest frame.
+ *  Contours can be simplified when they are added (Douglas-Peucker with a
+ *  tolerance in pixels of the source), so the strokes that are sequenced and
+ *  drawn carry far fewer points than the traced pixel steps. Area, centroid
+ *  and length stay those of the traced contour.
+ *  The blobs form a containment tree (see Contour::parent), so a stroke with
+ *  its holes and islands is a walk over its children.
+ */
+class BlobStore
+{
+    friend class BlobView;
+
+    vector<int>             mIds;           // stable over frames (see BlobTracker), -1 when not tracked
+    vector<ofPoint>         mCentroids;
+    vector<float>           mAreas;
+    vector<float>           mLengths;
+    vector<ofRectangle>     mBoundingRects;
+    vector<char>            mHoles;
+    vector<int>             mPointBegin;    // in points, not floats
+    vector<int>             mNumPoints;
+    vector<float>           mPoints;
+    vector<int>             mParents;       // -1 at the top
+    vector<int>             mFirstChild;    // -1 without children
+    vector<int>             mNextSibling;
+
+    // traced points of the simplified blobs, when they are kept
+    vector<int>             mOriginalBegin; // -1 when the blob was not simplified
+    vector<int>             mNumOriginalPoints;
+    vector<float>           mOriginalPoints;
+
+    float                   mTolerance;
+    bool                    bKeepOriginal;
+    vector<char>            mKeep;
+    vector<pair<int, int> > mSpans;
+
+    int push(const ofPoint& centroid, float area, float length, const ofRectangle& rect, bool hole, int nPts);
+    int simplify(const float* pts, int nPts, int stride);
+    void keepOriginal(int i, const float* pts, int nPts, int stride, float w, float h, float offsetW);
+
+public:
+    BlobStore() : mTolerance(0), bKeepOriginal(false) {}
+
+    /// tolerance in pixels (0 keeps every point), for the blobs added from now on
+    void setSimplification(float tolerance, bool bKeepOriginalPoints = false);
+    float getTolerance() const              { return mTolerance; }
+
+    /// a contour in pixels of a w x h image, shifted by offsetW before it is normalized
+    int add(const ContourSet& contours, int index, float w, float h, float offsetW = 0);
+    int add(const ofxCvBlob& blob, float w, float h, float offsetW = 0);
+    /// copy of a blob of another store, already normalized, with its id
+    int add(const BlobView& blob);
+    void setId(int i, int id)               { mIds[i] = id; }
+    /// puts blob i into the children of parent (-1 for none), once per blob
+    void setParent(int i, int parent);
+    /// copy of blob and everything inside it, returns the index of the copy of blob
+    int addTree(const BlobView& blob);
+    void pop_back();
+    void clear();
+
+    /// the blob with this id, an invalid view when it is not in the store
+    BlobView find(int id) const;
+
+    int size() const                        { return mAreas.size(); }
+    bool empty() const                      { return mAreas.empty(); }
+    int getTotalNumPoints() const           { return mPoints.size() / 2; }
+    BlobView operator[](int i) const        { return BlobView(this, i); }
+    BlobView back() const                   { return BlobView(this, size() - 1); }
+};
+
+
+int BlobView::getId() const                             { return mStore->mIds[mIndex]; }
+const ofPoint& BlobView::getCentroid() const            { return mStore->mCentroids[mIndex]; }
+float BlobView::getArea() const                         { return mStore->mAreas[mIndex]; }
+float BlobView::getLength() const                       { return mStore->mLengths[mIndex]; }
+const ofRectangle& BlobView::getBoundingRect() const    { return mStore->mBoundingRects[mIndex]; }
+bool BlobView::isHole() const                           { return mStore->mHoles[mIndex]; }
+int BlobView::getNumPoints() const                      { return mStore->mNumPoints[mIndex]; }
+const float* BlobView::getPoints() const                { return &mStore->mPoints[mStore->mPointBegin[mIndex] * 2]; }
+
+int BlobView::getNumOriginalPoints() const
+{
+    const int begin = mStore->mOriginalBegin[mIndex];
+    return begin < 0 ? getNumPoints() : mStore->mNumOriginalPoints[mIndex];
+}
+
+const float* BlobView::getOriginalPoints() const
+{
+    const int begin = mStore->mOriginalBegin[mIndex];
+    return begin < 0 ? getPoints() : &mStore->mOriginalPoints[begin * 2];
+}
+
+BlobView BlobView::getParent() const
+{
+    const int i = mStore->mParents[mIndex];
+    return i < 0 ? BlobView() : BlobView(mStore, i);
+}
+
+BlobView BlobView::getFirstChild() const
+{
+    const int i = mStore->mFirstChild[mIndex];
+    return i < 0 ? BlobView() : BlobView(mStore, i);
+}
+
+BlobView BlobView::getNextSibling() const
+{
+    const int i = mStore->mNextSibling[mIndex];
+    return i < 0 ? BlobView() : BlobView(mStore, i);
+}
+
+ofPoint BlobView::getPoint(int i) const
+{
+    const float* p = getPoints() + i * 2;
+    return ofPoint(p[0], p[1]);
+}
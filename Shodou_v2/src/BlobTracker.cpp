@@ -0,0 +1,84 @@
+#include "BlobTracker.h"
+
+float BlobTracker::getOverlap(const ofRectangle& a, const ofRectangle& b)
+{
+    const float w = MIN(a.x + a.width,  b.x + b.width)  - MAX(a.x, b.x);
+    const float h = MIN(a.y + a.height, b.y + b.height) - MAX(a.y, b.y);
+    if (w <= 0 || h <= 0) return 0;
+    const float intersection = w * h;
+    return intersection / (a.width * a.height + b.width * b.height - intersection);
+}
+
+void BlobTracker::update(const ContourSet& contours, bool bCarriedOver, const BlobStore& prev, BlobStore& blobs)
+{
+    blobs.clear();
+    mTaken.assign(prev.size(), 0);
+
+    // carried over contours keep their blob, the others are added untracked
+    const float w = contours.getWidth();
+    const float h = contours.getHeight();
+    for (int i = 0; i < contours.size(); i++)
+    {
+        const int p = contours[i].prevIndex;
+        if (bCarriedOver && p >= 0 && p < prev.size() && mTaken[p] == false)
+        {
+            blobs.add(prev[p]);
+            mTaken[p] = true;
+        }
+        else
+        {
+            blobs.add(contours, i, w, h, 0);
+        }
+    }
+    // a blob per contour, in the same order
+    for (int i = 0; i < contours.size(); i++) blobs.setParent(i, contours[i].parent);
+
+    // previous blobs that are still free, by the cell of their centroid
+    std::fill(mCellHead.begin(), mCellHead.end(), -1);
+    mNext.resize(prev.size());
+    for (int i = 0; i < prev.size(); i++)
+    {
+        if (mTaken[i]) continue;
+        const ofPoint& c = prev[i].getCentroid();
+        int& head = mCellHead[getCell(c.y) * GRID_SIZE + getCell(c.x)];
+        mNext[i] = head;
+        head = i;
+    }
+
+    for (int i = 0; i < blobs.size(); i++)
+    {
+        const BlobView blob = blobs[i];
+        if (blob.getId() >= 0) continue;
+
+        const ofPoint& c = blob.getCentroid();
+        const int cx = getCell(c.x);
+        const int cy = getCell(c.y);
+        int best = -1;
+        float bestOverlap = mMinOverlap;
+        for (int y = MAX(cy - 1, 0); y <= MIN(cy + 1, GRID_SIZE - 1); y++)
+        {
+            for (int x = MAX(cx - 1, 0); x <= MIN(cx + 1, GRID_SIZE - 1); x++)
+            {
+                for (int j = mCellHead[y * GRID_SIZE + x]; j >= 0; j = mNext[j])
+                {
+                    if (mTaken[j] || prev[j].isHole() != blob.isHole()) continue;
+                    const float overlap = getOverlap(blob.getBoundingRect(), prev[j].getBoundingRect());
+                    if (overlap >= bestOverlap)
+                    {
+                        best = j;
+                        bestOverlap = overlap;
+                    }
+                }
+            }
+        }
+        if (best >= 0)
+        {
+            blobs.setId(i, prev[best].getId());
+            mTaken[best] = true;
+        }
+        else
+        {
+            blobs.setId(i, newId());
+        }
+    }
+}
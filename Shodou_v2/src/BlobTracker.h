@@ -0,0 +1,41 @@
+#pragma once
+
+#include "BlobStore.h"
+
+/**
+ *  Builds the BlobStore of a frame from its contours and gives every blob the
+ *  id of the same stroke in the frame before, so sequencers and animations
+ *  can follow a stroke while the blob order changes.
+ *  Contours the tracer carried over are copied with their id. The others are
+ *  matched against the previous blobs that are still free: the previous
+ *  centroids go into a fixed grid, and each new blob looks at the 3 x 3 cells
+ *  around its centroid and takes the candidate of the same kind (stroke or
+ *  hole) whose bounding box overlaps its own most, by intersection over union.
+ *  Blobs without a match get a new id. Blobs are matched in contour order
+ *  (largest first), so the cost is linear in the number of blobs.
+ */
+class BlobTracker
+{
+    static const int GRID_SIZE = 16;    // cells per side of the normalized image
+
+    vector<int>     mCellHead;          // first previous blob in a cell, -1 when empty
+    vector<int>     mNext;              // next previous blob in the same cell
+    vector<char>    mTaken;
+    int             mNextId;
+    float           mMinOverlap;
+
+    static int getCell(float v)         { return ofClamp((int)(v * GRID_SIZE), 0, GRID_SIZE - 1); }
+    static float getOverlap(const ofRectangle& a, const ofRectangle& b);
+
+public:
+    BlobTracker() : mCellHead(GRID_SIZE * GRID_SIZE), mNextId(0), mMinOverlap(0.3) {}
+
+    /// blobs = contours (normalized to their size, with their containment tree), with ids from prev
+    void update(const ContourSet& contours, bool bCarriedOver, const BlobStore& prev, BlobStore& blobs);
+
+    /// an id for a blob that is added by hand
+    int newId()                         { return mNextId++; }
+
+    /// least bounding box intersection over union of a match (0 - 1)
+    void setMinOverlap(float v)         { mMinOverlap = v; }
+};
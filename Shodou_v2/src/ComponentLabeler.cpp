@@ -0,0 +1,267 @@
+#include "ComponentLabeler.h"
+
+// bands thinner than this are not worth a task
+static const int MIN_BAND_ROWS = 16;
+
+// first x >= x whose bit equals bSet, or w
+static int findBit(const BinaryMask::word_t* row, int x, int w, bool bSet)
+{
+    while (x < w)
+    {
+        const int k = x / BinaryMask::WORD_BITS;
+        BinaryMask::word_t word = bSet ? row[k] : ~row[k];
+        word &= ~(BinaryMask::word_t)0 << (x % BinaryMask::WORD_BITS);
+        if (word)
+        {
+            return MIN(w, k * BinaryMask::WORD_BITS + __builtin_ctzll(word));
+        }
+        x = (k + 1) * BinaryMask::WORD_BITS;
+    }
+    return w;
+}
+
+// sum of i for i in [0, n) and of i * i
+static double sum1(double n) { return n * (n - 1) * 0.5; }
+static double sum2(double n) { return (n - 1) * n * (2 * n - 1) / 6.0; }
+
+static void finishStats(ComponentStats& s, double sx, double sy, double sxx, double sxy, double syy,
+                        int minX, int minY, int maxX, int maxY)
+{
+    const double n = s.area;
+    const double cx = sx / n;
+    const double cy = sy / n;
+    s.centroid.set(cx, cy);
+    s.mu20 = sxx / n - cx * cx;
+    s.mu11 = sxy / n - cx * cy;
+    s.mu02 = syy / n - cy * cy;
+    s.boundingRect.set(minX, minY, maxX - minX + 1, maxY - minY + 1);
+}
+
+
+ComponentLabeler::ComponentLabeler()
+: mParentCapacity(0)
+, mWidth(0)
+, mHeight(0)
+, bWriteLabelImage(true)
+{
+}
+
+int ComponentLabeler::find(int a)
+{
+    // path halving, a lost CAS only means another thread compressed it first
+    while (true)
+    {
+        int p = mParent[a].load(std::memory_order_relaxed);
+        if (p == a) return a;
+        const int gp = mParent[p].load(std::memory_order_relaxed);
+        if (gp != p) mParent[a].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+        a = gp;
+    }
+}
+
+void ComponentLabeler::unite(int a, int b)
+{
+    while (true)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (a < b) swap(a, b);
+        // hang the larger root under the smaller one, retry if a was linked meanwhile
+        int expected = a;
+        if (mParent[a].compare_exchange_strong(expected, b)) return;
+    }
+}
+
+void ComponentLabeler::uniteRows(const Run* prev, int nPrev, int prevBegin, const Run* cur, int nCur, int curBegin)
+{
+    int k = 0;
+    for (int j = 0; j < nCur; ++j)
+    {
+        const Run& c = cur[j];
+        while (k < nPrev && prev[k].x1 < c.x0) ++k;
+        for (int m = k; m < nPrev && prev[m].x0 <= c.x1; ++m)
+        {
+            const Run& p = prev[m];
+            if (p.set != c.set) continue;
+            // set runs also touch diagonally, clear runs only when they overlap
+            const bool bTouch = c.set ? (p.x0 <= c.x1 && c.x0 <= p.x1)
+                                      : (p.x0 <  c.x1 && c.x0 <  p.x1);
+            if (bTouch) unite(prevBegin + m, curBegin + j);
+        }
+    }
+}
+
+void ComponentLabeler::extractRuns(const BinaryMask& mask, Band& band)
+{
+    band.runs.clear();
+    for (int y = band.y0; y < band.y1; ++y)
+    {
+        const BinaryMask::word_t* row = mask.getRow(y);
+        int x = 0;
+        while (x < mWidth)
+        {
+            const bool bSet = (row[x / BinaryMask::WORD_BITS] >> (x % BinaryMask::WORD_BITS)) & 1;
+            const int end = findBit(row, x, mWidth, !bSet);
+            Run r = { y, x, end, bSet };
+            band.runs.push_back(r);
+            x = end;
+        }
+    }
+}
+
+void ComponentLabeler::uniteBand(Band& band)
+{
+    const int n = band.runs.size();
+    for (int i = 0; i < n; ++i)
+    {
+        mParent[band.runBegin + i].store(band.runBegin + i, std::memory_order_relaxed);
+    }
+
+    const Run* runs = band.runs.empty() ? NULL : &band.runs[0];
+    int prevBegin = 0, curBegin = 0;
+    while (curBegin < n)
+    {
+        int curEnd = curBegin;
+        while (curEnd < n && runs[curEnd].y == runs[curBegin].y) ++curEnd;
+        if (curBegin > 0)
+        {
+            uniteRows(runs + prevBegin, curBegin - prevBegin, band.runBegin + prevBegin,
+                      runs + curBegin, curEnd - curBegin, band.runBegin + curBegin);
+        }
+        prevBegin = curBegin;
+        curBegin = curEnd;
+    }
+}
+
+void ComponentLabeler::label(const BinaryMask& mask, ThreadPool& pool)
+{
+    mWidth  = mask.getWidth();
+    mHeight = mask.getHeight();
+    mForeground.clear();
+    mBackground.clear();
+    if (mask.isAllocated() == false) return;
+
+    // horizontal bands, a couple per thread for balance
+    const int nBands = MAX(1, MIN(mHeight / MIN_BAND_ROWS, pool.getNumThreads() * 2));
+    mBands.resize(nBands);
+    for (int i = 0; i < nBands; ++i)
+    {
+        mBands[i].y0 = mHeight * i / nBands;
+        mBands[i].y1 = mHeight * (i + 1) / nBands;
+    }
+
+    pool.parallelFor(nBands, [&](int i){ extractRuns(mask, mBands[i]); });
+
+    int nRuns = 0;
+    for (auto& e : mBands)
+    {
+        e.runBegin = nRuns;
+        nRuns += e.runs.size();
+    }
+    if (nRuns > mParentCapacity)
+    {
+        mParent.reset(new std::atomic<int>[nRuns]);
+        mParentCapacity = nRuns;
+    }
+
+    pool.parallelFor(nBands, [&](int i){ uniteBand(mBands[i]); });
+
+    // the last row of band i against the first row of band i + 1
+    pool.parallelFor(nBands - 1, [&](int i)
+    {
+        const Band& a = mBands[i];
+        const Band& b = mBands[i + 1];
+        if (a.runs.empty() || b.runs.empty()) return;
+        int aBegin = a.runs.size();
+        while (aBegin > 0 && a.runs[aBegin - 1].y == a.y1 - 1) --aBegin;
+        int bEnd = 0;
+        while (bEnd < (int)b.runs.size() && b.runs[bEnd].y == b.y0) ++bEnd;
+        uniteRows(&a.runs[aBegin], a.runs.size() - aBegin, a.runBegin + aBegin,
+                  &b.runs[0], bEnd, b.runBegin);
+    });
+
+    // roots are the first run of their component, so labels come out in raster order
+    mRunLabels.resize(nRuns);
+    mForegroundAccum.clear();
+    mBackgroundAccum.clear();
+    for (const auto& band : mBands)
+    {
+        for (int i = 0; i < (int)band.runs.size(); ++i)
+        {
+            const Run& r = band.runs[i];
+            const int g = band.runBegin + i;
+            const int root = find(g);
+            vector<ComponentStats>& stats = r.set ? mForeground : mBackground;
+            vector<Accum>& accum = r.set ? mForegroundAccum : mBackgroundAccum;
+
+            int idx;
+            if (root == g)
+            {
+                idx = stats.size();
+                ComponentStats s;
+                s.area = 0;
+                s.startX = r.x0;
+                s.startY = r.y;
+                s.parent = r.x0 > 0 ? mRunLabels[g - 1] : -1;
+                s.touchesFrame = false;
+                stats.push_back(s);
+                Accum a = { 0, 0, 0, 0, 0, r.x0, r.y, r.x1 - 1, r.y };
+                accum.push_back(a);
+            }
+            else
+            {
+                idx = mRunLabels[root];
+            }
+            mRunLabels[g] = idx;
+
+            ComponentStats& s = stats[idx];
+            Accum& a = accum[idx];
+            const int len = r.x1 - r.x0;
+            const double sx  = sum1(r.x1) - sum1(r.x0);
+            const double sxx = sum2(r.x1) - sum2(r.x0);
+            s.area += len;
+            a.sx  += sx;
+            a.sy  += (double)r.y * len;
+            a.sxx += sxx;
+            a.sxy += r.y * sx;
+            a.syy += (double)r.y * r.y * len;
+            a.minX = MIN(a.minX, r.x0);
+            a.maxX = MAX(a.maxX, r.x1 - 1);
+            a.maxY = r.y;
+            if (r.x0 == 0 || r.x1 == mWidth || r.y == 0 || r.y == mHeight - 1)
+            {
+                s.touchesFrame = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < (int)mForeground.size(); ++i)
+    {
+        const Accum& a = mForegroundAccum[i];
+        finishStats(mForeground[i], a.sx, a.sy, a.sxx, a.sxy, a.syy, a.minX, a.minY, a.maxX, a.maxY);
+    }
+    for (int i = 0; i < (int)mBackground.size(); ++i)
+    {
+        const Accum& a = mBackgroundAccum[i];
+        finishStats(mBackground[i], a.sx, a.sy, a.sxx, a.sxy, a.syy, a.minX, a.minY, a.maxX, a.maxY);
+    }
+
+    if (bWriteLabelImage)
+    {
+        // the runs of a row cover it completely, so the image needs no clearing
+        mLabels.resize(mWidth * mHeight);
+        pool.parallelFor(nBands, [&](int i)
+        {
+            const Band& band = mBands[i];
+            for (int j = 0; j < (int)band.runs.size(); ++j)
+            {
+                const Run& r = band.runs[j];
+                const int idx = mRunLabels[band.runBegin + j];
+                const int v = r.set ? idx + 1 : -(idx + 1);
+                int* dst = &mLabels[r.y * mWidth];
+                for (int x = r.x0; x < r.x1; ++x) dst[x] = v;
+            }
+        });
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BinaryMask.hpp"
+#include "../../common/ThreadPool.hpp"
+
+/**
+ *  Statistics of one connected component, accumulated from its runs.
+ */
+struct ComponentStats
+{
+    int         area;               // pixels
+    ofRectangle boundingRect;
+    ofPoint     centroid;
+    double      mu20, mu11, mu02;   // central second moments, normalized by area
+    int         startX, startY;     // first pixel in raster order
+    int         parent;             // component of the other kind left of the first pixel, -1 at the frame
+    bool        touchesFrame;
+};
+
+
+/**
+ *  Connected component labeling of a BinaryMask, band parallel.
+ *  Set pixels are labeled 8-connected, clear pixels 4-connected, so every
+ *  background component that does not touch the frame is a hole.
+ *
+ *  The mask is cut into horizontal bands. Each band turns its rows into runs
+ *  and unites overlapping runs of neighbouring rows on its own, then the band
+ *  seams are united in parallel with a lock-free union-find (CAS on the
+ *  parent, the smaller run index always wins, so a root is the first run of
+ *  its component). Labels, statistics and the label image follow from the
+ *  runs without another pass over the pixels.
+ *
+ *  Label image: foreground i is stored as i + 1, background i as -(i + 1).
+ */
+class ComponentLabeler
+{
+    struct Run
+    {
+        int     y, x0, x1;          // [x0, x1)
+        bool    set;
+    };
+
+    struct Band
+    {
+        int         y0, y1;
+        int         runBegin;       // global index of the first run
+        vector<Run> runs;
+    };
+
+    struct Accum
+    {
+        double      sx, sy, sxx, sxy, syy;
+        int         minX, minY, maxX, maxY;
+    };
+
+    vector<Band>            mBands;
+    vector<int>             mRunLabels;
+    std::unique_ptr<std::atomic<int>[]> mParent;
+    int                     mParentCapacity;
+    vector<int>             mLabels;
+    vector<ComponentStats>  mForeground;
+    vector<ComponentStats>  mBackground;
+    vector<Accum>           mForegroundAccum;
+    vector<Accum>           mBackgroundAccum;
+    int                     mWidth, mHeight;
+    bool                    bWriteLabelImage;
+
+    int find(int a);
+    void unite(int a, int b);
+    void uniteRows(const Run* prev, int nPrev, int prevBegin, const Run* cur, int nCur, int curBegin);
+    void extractRuns(const BinaryMask& mask, Band& band);
+    void uniteBand(Band& band);
+
+public:
+    ComponentLabeler();
+
+    void label(const BinaryMask& mask, ThreadPool& pool = ThreadPool::getShared());
+
+    /// the label image is written by label() only while enabled (default on)
+    void setLabelImageEnabled(bool b)   { bWriteLabelImage = b; }
+
+    const vector<ComponentStats>& getForeground() const { return mForeground; }
+    const vector<ComponentStats>& getBackground() const { return mBackground; }
+    const int* getLabels() const        { return mLabels.empty() ? NULL : &mLabels[0]; }
+    int getLabel(int x, int y) const    { return mLabels[y * mWidth + x]; }
+    int getWidth() const                { return mWidth; }
+    int getHeight() const               { return mHeight; }
+};
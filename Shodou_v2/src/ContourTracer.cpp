@@ -0,0 +1,351 @@
+#include "ContourTracer.h"
+#include <climits>
+
+// neighbours counterclockwise (y down), starting at the right
+static const int DIR_X[8] = { 1,  1,  0, -1, -1, -1,  0,  1 };
+static const int DIR_Y[8] = { 0, -1, -1, -1,  0,  1,  1,  1 };
+
+static bool compareArea(const Contour& a, const Contour& b)
+{
+    return a.area > b.area;
+}
+
+static inline bool isSet(const BinaryMask& mask, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < mask.getWidth() && y < mask.getHeight() && mask.get(x, y);
+}
+
+void ContourTracer::traceBorder(const BinaryMask& mask, const Seed& seed, bool bUseApproximation,
+                                vector<float>& points, Contour& c)
+{
+    const int x0 = seed.x;
+    const int y0 = seed.y;
+
+    c.pointBegin = points.size() / 2;
+    c.nPts = 0;
+    c.hole = seed.hole;
+    c.prevIndex = -1;
+
+    // (3.1) first set neighbour clockwise from where we came from
+    // (the left pixel for an outer border, the right one for a hole)
+    const int dFrom = seed.hole ? 0 : 4;
+    int d1 = -1;
+    for (int k = 0; k < 8; ++k)
+    {
+        const int d = (dFrom - k) & 7;
+        if (isSet(mask, x0 + DIR_X[d], y0 + DIR_Y[d]))
+        {
+            d1 = d;
+            break;
+        }
+    }
+    if (d1 < 0)
+    {
+        // isolated pixel
+        points.push_back(x0);
+        points.push_back(y0);
+        c.nPts = 1;
+        c.area = 0;
+        c.length = 0;
+        c.centroid.set(x0, y0);
+        c.boundingRect.set(x0, y0, 1, 1);
+        return;
+    }
+
+    const int x1 = x0 + DIR_X[d1];
+    const int y1 = y0 + DIR_Y[d1];
+    int dPrev = d1;         // direction from the current pixel to the previous one
+    int dIn = -1;           // direction of the step into the current pixel
+    int x = x0, y = y0;
+    int minX = x0, maxX = x0, minY = y0, maxY = y0;
+    double a00 = 0, a10 = 0, a01 = 0, length = 0;
+
+    while (true)
+    {
+        // (3.3) next set neighbour counterclockwise
+        int d4 = dPrev;
+        for (int k = 1; k <= 8; ++k)
+        {
+            const int d = (dPrev + k) & 7;
+            if (isSet(mask, x + DIR_X[d], y + DIR_Y[d]))
+            {
+                d4 = d;
+                break;
+            }
+        }
+
+        // keep the pixel unless it continues a straight run
+        if (bUseApproximation == false || dIn < 0 || d4 != dIn)
+        {
+            points.push_back(x);
+            points.push_back(y);
+            c.nPts++;
+        }
+
+        // moments and arc length of the edge to the next pixel (Green's theorem)
+        const int nx = x + DIR_X[d4];
+        const int ny = y + DIR_Y[d4];
+        const double cross = (double)x * ny - (double)nx * y;
+        a00 += cross;
+        a10 += (x + nx) * cross;
+        a01 += (y + ny) * cross;
+        length += (d4 & 1) ? M_SQRT2 : 1.0;
+
+        // (3.5) back at the start
+        if (nx == x0 && ny == y0 && x == x1 && y == y1) break;
+
+        dPrev = (d4 + 4) & 7;
+        dIn = d4;
+        x = nx;
+        y = ny;
+        minX = MIN(minX, x);
+        maxX = MAX(maxX, x);
+        minY = MIN(minY, y);
+        maxY = MAX(maxY, y);
+    }
+
+    c.area = fabs(a00) * 0.5;
+    c.length = length;
+    if (a00 != 0)
+    {
+        c.centroid.set(a10 / (3.0 * a00), a01 / (3.0 * a00));
+    }
+    else
+    {
+        c.centroid.set((minX + maxX) * 0.5, (minY + maxY) * 0.5);
+    }
+    c.boundingRect.set(minX, minY, maxX - minX + 1, maxY - minY + 1);
+}
+
+ContourTracer::ContourTracer()
+: mDirtyBegin(0)
+, mDirtyEnd(INT_MAX)
+, bLastApproximation(true)
+{
+    // only the statistics are needed here
+    mLabeler.setLabelImageEnabled(false);
+}
+
+void ContourTracer::setDirtyRows(int rowBegin, int rowEnd)
+{
+    mDirtyBegin = rowBegin;
+    mDirtyEnd   = rowEnd;
+}
+
+int ContourTracer::findContours(const BinaryMask& mask, float minArea, float maxArea, int nConsidered,
+                                bool bFindHoles, bool bUseApproximation)
+{
+    ThreadPool& pool = ThreadPool::getShared();
+
+    // the last result is only valid for a mask of the same size and the same point approximation
+    const bool bIncremental = mask.getWidth() == mWidth && mask.getHeight() == mHeight
+        && bUseApproximation == bLastApproximation && (mDirtyBegin > 0 || mDirtyEnd < mHeight);
+    bLastApproximation = bUseApproximation;
+    mPrevKeys.clear();
+    if (bIncremental)
+    {
+        for (int i = 0; i < (int)mContours.size(); ++i)
+        {
+            const Contour& c = mContours[i];
+            const float* p = getPoints(c);
+            mPrevKeys.push_back(make_pair(seedKey(p[0], p[1], c.hole, mWidth), i));
+        }
+        sort(mPrevKeys.begin(), mPrevKeys.end());
+    }
+    mPrevPoints.swap(mPoints);
+    mPrevContours.swap(mContours);
+    const int dirtyBegin = mDirtyBegin;
+    const int dirtyEnd   = mDirtyEnd;
+    mDirtyBegin = 0;
+    mDirtyEnd   = INT_MAX;
+
+    mWidth  = mask.getWidth();
+    mHeight = mask.getHeight();
+    mPoints.clear();
+    mContours.clear();
+    mLabeler.label(mask, pool);
+
+    // one border per component, and per hole when asked for
+    const vector<ComponentStats>& fg = mLabeler.getForeground();
+    const vector<ComponentStats>& bg = mLabeler.getBackground();
+    mSeeds.clear();
+    for (int i = 0; i < (int)fg.size(); ++i)
+    {
+        const ComponentStats& e = fg[i];
+        // without holes only the outermost components, like CV_RETR_EXTERNAL
+        if (bFindHoles == false && e.parent >= 0 && bg[e.parent].touchesFrame == false) continue;
+        Seed s = { e.startX, e.startY, false, i };
+        mSeeds.push_back(s);
+    }
+    if (bFindHoles)
+    {
+        for (int i = 0; i < (int)bg.size(); ++i)
+        {
+            const ComponentStats& e = bg[i];
+            if (e.touchesFrame) continue;
+            Seed s = { e.startX - 1, e.startY, true, i };
+            mSeeds.push_back(s);
+        }
+    }
+
+    // contiguous chunks of seeds, each into its own point array
+    const int nSeeds = mSeeds.size();
+    const int nChunks = MAX(1, MIN(nSeeds, pool.getNumThreads() * 4));
+    mChunkPoints.resize(nChunks);
+    mChunkContours.resize(nChunks);
+    pool.parallelFor(nChunks, [&](int i)
+    {
+        vector<float>& points = mChunkPoints[i];
+        vector<Contour>& contours = mChunkContours[i];
+        points.clear();
+        contours.clear();
+        const int end = nSeeds * (i + 1) / nChunks;
+        for (int j = nSeeds * i / nChunks; j < end; ++j)
+        {
+            Contour c;
+            if (bIncremental == false || carryOver(mSeeds[j], dirtyBegin, dirtyEnd, points, c) == false)
+            {
+                traceBorder(mask, mSeeds[j], bUseApproximation, points, c);
+            }
+            c.component = mSeeds[j].component;
+            if (c.area > minArea && c.area < maxArea)
+            {
+                contours.push_back(c);
+            }
+            else
+            {
+                points.resize(c.pointBegin * 2);
+            }
+        }
+    });
+
+    for (int i = 0; i < nChunks; ++i)
+    {
+        const int base = mPoints.size() / 2;
+        mPoints.insert(mPoints.end(), mChunkPoints[i].begin(), mChunkPoints[i].end());
+        for (auto c : mChunkContours[i])
+        {
+            c.pointBegin += base;
+            mContours.push_back(c);
+        }
+    }
+
+    mNumCarried = 0;
+    for (const auto& c : mContours) mNumCarried += c.prevIndex >= 0;
+
+    sort(mContours.begin(), mContours.end(), compareArea);
+    if ((int)mContours.size() > nConsidered) mContours.resize(nConsidered);
+    findParents();
+    return mContours.size();
+}
+
+void ContourTracer::findParents()
+{
+    // the labeler knows the component around each one: a hole is enclosed by a
+    // component, a component by a hole or by the frame
+    const vector<ComponentStats>& fg = mLabeler.getForeground();
+    const vector<ComponentStats>& bg = mLabeler.getBackground();
+    mForegroundContour.assign(fg.size(), -1);
+    mBackgroundContour.assign(bg.size(), -1);
+    for (int i = 0; i < (int)mContours.size(); ++i)
+    {
+        const Contour& c = mContours[i];
+        (c.hole ? mBackgroundContour : mForegroundContour)[c.component] = i;
+    }
+
+    // the nearest enclosing component that kept its contour (the others were
+    // too small or too large, or not asked for)
+    for (auto& c : mContours)
+    {
+        c.parent = -1;
+        int component = c.component;
+        bool hole = c.hole;
+        while (true)
+        {
+            component = hole ? bg[component].parent : fg[component].parent;
+            hole = !hole;
+            if (component < 0 || (hole && bg[component].touchesFrame)) break;
+            const int k = (hole ? mBackgroundContour : mForegroundContour)[component];
+            if (k >= 0)
+            {
+                c.parent = k;
+                break;
+            }
+        }
+    }
+}
+
+bool ContourTracer::carryOver(const Seed& seed, int dirtyBegin, int dirtyEnd,
+                              vector<float>& points, Contour& c) const
+{
+    const pair<int64_t, int> key(seedKey(seed.x, seed.y, seed.hole, mWidth), -1);
+    const auto it = lower_bound(mPrevKeys.begin(), mPrevKeys.end(), key);
+    if (it == mPrevKeys.end() || it->first != key.first) return false;
+
+    // the walk reads one pixel around the border
+    const Contour& prev = mPrevContours[it->second];
+    const int y0 = prev.boundingRect.y - 1;
+    const int y1 = prev.boundingRect.y + prev.boundingRect.height + 1;
+    if (y1 > dirtyBegin && y0 < dirtyEnd) return false;
+
+    c = prev;
+    c.pointBegin = points.size() / 2;
+    c.prevIndex = it->second;
+    const float* p = &mPrevPoints[prev.pointBegin * 2];
+    points.insert(points.end(), p, p + prev.nPts * 2);
+    return true;
+}
+
+void ContourSet::draw(float x, float y, float w, float h) const
+{
+    const float scaleX = mWidth  ? w / mWidth  : 1;
+    const float scaleY = mHeight ? h / mHeight : 1;
+
+    ofPushStyle();
+    ofPushMatrix();
+    ofTranslate(x, y);
+    ofScale(scaleX, scaleY);
+    ofNoFill();
+    for (const auto& c : mContours)
+    {
+        const float* pts = getPoints(c);
+        ofSetHexColor(0x00FFFF);
+        ofBeginShape();
+        for (int i = 0; i < c.nPts; ++i)
+        {
+            ofVertex(pts[i * 2], pts[i * 2 + 1]);
+        }
+        ofEndShape(true);
+        ofSetHexColor(0xff0099);
+        ofRect(c.boundingRect);
+    }
+    ofPopMatrix();
+    ofPopStyle();
+}
+
+
+
+void ContourFinderAdapter::setFromContours(const ContourSet& contours)
+{
+    _width  = contours.getWidth();
+    _height = contours.getHeight();
+    nBlobs  = contours.size();
+    blobs.resize(nBlobs);
+    for (int i = 0; i < nBlobs; ++i)
+    {
+        const Contour& c = contours[i];
+        const float* pts = contours.getPoints(c);
+        ofxCvBlob& blob = blobs[i];
+        blob.area         = c.area;
+        blob.length       = c.length;
+        blob.hole         = c.hole;
+        blob.centroid     = c.centroid;
+        blob.boundingRect = c.boundingRect;
+        blob.nPts         = c.nPts;
+        blob.pts.resize(c.nPts);
+        for (int j = 0; j < c.nPts; ++j)
+        {
+            blob.pts[j].set(pts[j * 2], pts[j * 2 + 1]);
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOpenCv.h"
+#include "BinaryMask.hpp"
+#include "ComponentLabeler.h"
+
+/**
+ *  One traced border. The points are (x, y) pairs in the flat array of the
+ *  tracer, starting at pointBegin (in points, not floats).
+ */
+struct Contour
+{
+    int         pointBegin;
+    int         nPts;
+    float       area;
+    float       length;
+    ofPoint     centroid;
+    ofRectangle boundingRect;
+    bool        hole;
+    int         prevIndex;      // index in the previous findContours() when carried over, else -1
+    int         component;      // of the labeler, in its background for a hole
+    int         parent;         // enclosing contour (stroke -> hole -> island), -1 at the top
+};
+
+
+/**
+ *  Result of a ContourTracer: the contours and their points in one flat
+ *  array. Copying it into a set that was used before does not allocate,
+ *  so finished results can be handed to another thread by value.
+ */
+class ContourSet
+{
+protected:
+    vector<float>           mPoints;
+    vector<Contour>         mContours;
+    int                     mWidth, mHeight;
+    int                     mNumCarried;
+
+public:
+    ContourSet() : mWidth(0), mHeight(0), mNumCarried(0) {}
+
+    void draw(float x, float y, float w, float h) const;
+
+    int size() const                                { return mContours.size(); }
+    const Contour& operator[](int i) const          { return mContours[i]; }
+    const vector<Contour>& getContours() const      { return mContours; }
+    const float* getPoints(const Contour& c) const  { return &mPoints[c.pointBegin * 2]; }
+    int getWidth() const                            { return mWidth; }
+    int getHeight() const                           { return mHeight; }
+    int getNumCarried() const                       { return mNumCarried; }
+};
+
+
+/**
+ *  Contours of a BinaryMask, 8-connected like cv::findContours.
+ *  ComponentLabeler finds the components and holes in parallel; every outer
+ *  border starts at the first pixel of its component and every hole border
+ *  left of the first pixel of its hole, so the borders are independent and
+ *  are followed (Suzuki & Abe 1985) in parallel straight on the mask bits.
+ *  Area, centroid, bounding box and arc length are accumulated while the
+ *  border is walked, and the points go into one flat float array, so no
+ *  CvSeq or per-blob vector is built.
+ *  findContours() takes the same arguments as ofxCvContourFinder.
+ */
+class ContourTracer : public ContourSet
+{
+    struct Seed
+    {
+        int     x, y;
+        bool    hole;
+        int     component;
+    };
+
+    // seed of a border as one sortable number (the seed is its first point)
+    static int64_t seedKey(int x, int y, bool hole, int width)
+    {
+        return (((int64_t)y * (width + 1) + x) << 1) | hole;
+    }
+
+    ComponentLabeler        mLabeler;
+    vector<Seed>            mSeeds;
+    vector<vector<float> >  mChunkPoints;
+    vector<vector<Contour> > mChunkContours;
+    vector<int>             mForegroundContour;     // contour of a component, -1 when it has none
+    vector<int>             mBackgroundContour;
+
+    // the previous result, looked up by seed for borders outside the dirty rows
+    vector<float>           mPrevPoints;
+    vector<Contour>         mPrevContours;
+    vector<pair<int64_t, int> > mPrevKeys;
+    int                     mDirtyBegin, mDirtyEnd;
+    bool                    bLastApproximation;
+
+    static void traceBorder(const BinaryMask& mask, const Seed& seed, bool bUseApproximation,
+                            vector<float>& points, Contour& c);
+    bool carryOver(const Seed& seed, int dirtyBegin, int dirtyEnd, vector<float>& points, Contour& c) const;
+    void findParents();
+
+public:
+    ContourTracer();
+
+    /**
+     *  Only rows [rowBegin, rowEnd) of the next mask differ from the last one.
+     *  Borders whose bounding box (plus the one pixel the walk looks at) stays
+     *  outside of them are copied from the last result instead of traced.
+     *  Holds for the next findContours() only, which otherwise traces everything.
+     */
+    void setDirtyRows(int rowBegin, int rowEnd);
+
+    /// returns the number of contours, sorted by area (largest first), each with its enclosing contour
+    int findContours(const BinaryMask& mask, float minArea, float maxArea, int nConsidered,
+                     bool bFindHoles, bool bUseApproximation = true);
+
+    const ComponentLabeler& getLabeler() const      { return mLabeler; }
+};
+
+
+/**
+ *  ofxCvContourFinder view of a ContourSet for the existing callers
+ *  (blobs, getWidth/Height, draw). It copies the contours into ofxCvBlobs,
+ *  so only fill it when a legacy caller asks for it.
+ */
+class ContourFinderAdapter : public ofxCvContourFinder
+{
+public:
+    void setFromContours(const ContourSet& contours);
+};
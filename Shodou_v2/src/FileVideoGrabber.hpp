@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ofMain.h"
+#include "RawFrameFile.hpp"
+#include "RgbToGray.hpp"
+
+/**
+ *  Stand-in camera for ofVideoGrabber::setGrabber(): plays a raw frame file
+ *  (see RawFramePlayer) in a loop at its recorded rate, so the camera path
+ *  runs without hardware. It delivers OF_PIXELS_MONO or OF_PIXELS_RGB like a
+ *  real device; frames already in the asked format are views into the file,
+ *  the others are converted.
+ */
+class FileVideoGrabber : public ofBaseVideoGrabber
+{
+    RawFramePlayer      mPlayer;
+    const string        mPath;
+    ofPixelFormat       mPixelFormat;
+    ofPixels            mConverted;
+    ofPixels*           mFrame;
+    bool                bInitialized;
+
+    void convertFrame()
+    {
+        ofPixels& src = mPlayer.getPixelsRef();
+        const int channels = mPixelFormat == OF_PIXELS_MONO ? 1 : 3;
+        if (src.getNumChannels() == channels)
+        {
+            mFrame = &src;
+            return;
+        }
+        const int w = src.getWidth();
+        const int h = src.getHeight();
+        if (mConverted.getWidth() != w || mConverted.getHeight() != h || mConverted.getNumChannels() != channels)
+        {
+            mConverted.allocate(w, h, channels);
+        }
+        const unsigned char* s = src.getPixels();
+        unsigned char* d = mConverted.getPixels();
+        if (channels == 1)
+        {
+            for (int y = 0; y < h; ++y) ImageProcessing::gray::convertRow(s + y * w * 3, d + y * w, w);
+        }
+        else
+        {
+            for (int i = 0; i < w * h; ++i, d += 3) d[0] = d[1] = d[2] = s[i];
+        }
+        mFrame = &mConverted;
+    }
+
+public:
+    explicit FileVideoGrabber(const string& path)
+    : mPath(path), mPixelFormat(OF_PIXELS_RGB), mFrame(NULL), bInitialized(false)
+    {}
+
+    vector<ofVideoDevice> listDevices()
+    {
+        vector<ofVideoDevice> devices(1);
+        devices[0].id = 0;
+        devices[0].deviceName = "frame file: " + mPath;
+        devices[0].bAvailable = true;
+        return devices;
+    }
+
+    /// the size of the recording, whatever was asked for
+    bool initGrabber(int /*w*/, int /*h*/)
+    {
+        bInitialized = mPlayer.load(mPath);
+        if (bInitialized == false) return false;
+        mPlayer.setLoop(true);
+        mPlayer.play();
+        convertFrame();
+        return true;
+    }
+
+    void update()
+    {
+        mPlayer.update();
+        if (mPlayer.isFrameNew()) convertFrame();
+    }
+
+    bool isFrameNew()           { return mPlayer.isFrameNew(); }
+    unsigned char* getPixels()  { return mFrame ? mFrame->getPixels() : NULL; }
+    ofPixels& getPixelsRef()    { return mFrame ? *mFrame : mConverted; }
+
+    void close()
+    {
+        mPlayer.close();
+        mFrame = NULL;
+        bInitialized = false;
+    }
+
+    float getWidth()            { return mPlayer.getWidth(); }
+    float getHeight()           { return mPlayer.getHeight(); }
+
+    bool setPixelFormat(ofPixelFormat pixelFormat)
+    {
+        if (pixelFormat != OF_PIXELS_MONO && pixelFormat != OF_PIXELS_RGB) return false;
+        mPixelFormat = pixelFormat;
+        if (bInitialized) convertFrame();
+        return true;
+    }
+
+    ofPixelFormat getPixelFormat() { return mPixelFormat; }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ofMain.h"
+
+/**
+ *  One aligned block carved into the per-stage pixel buffers of a controller.
+ *  Stage ofPixels are bound as views (setFromExternalPixels) into the block.
+ *  The block only grows, so relayouting for the same or a smaller resolution
+ *  never touches the heap.
+ *
+ *      arena.begin();
+ *      arena.add(mGrayPix, w, h, 1);
+ *      ...
+ *      arena.end();
+ */
+class FrameArena
+{
+    static const size_t ALIGNMENT = 64;
+
+    struct Slot
+    {
+        ofPixels*   view;
+        int         w, h, ch;
+        size_t      offset;
+    };
+
+    vector<unsigned char>   mBlock;
+    vector<Slot>            mSlots;
+    size_t                  mSize;
+    int                     mNumAllocations;
+
+    static size_t alignUp(size_t n)
+    {
+        return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+public:
+    FrameArena() : mSize(0), mNumAllocations(0) {}
+
+    void begin()
+    {
+        mSlots.clear();
+        mSize = 0;
+    }
+
+    void add(ofPixels& view, int w, int h, int ch)
+    {
+        Slot s = { &view, w, h, ch, mSize };
+        mSlots.push_back(s);
+        mSize += alignUp((size_t)w * h * ch);
+    }
+
+    void end()
+    {
+        if (mSize + ALIGNMENT > mBlock.size())
+        {
+            // views still point into the old block until they are rebound below
+            vector<unsigned char>(mSize + ALIGNMENT).swap(mBlock);
+            mNumAllocations++;
+        }
+        unsigned char* base = &mBlock[0];
+        base += alignUp((size_t)base) - (size_t)base;
+        for (const auto& s : mSlots)
+        {
+            s.view->setFromExternalPixels(base + s.offset, s.w, s.h, s.ch);
+        }
+    }
+
+    size_t getCapacity() const { return mBlock.size(); }
+    int getNumAllocations() const { return mNumAllocations; }
+};
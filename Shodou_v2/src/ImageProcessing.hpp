@@ -2,6 +2,7 @@
 
 #include "ofMain.h"
 #include "utils.h"
+#include "RgbToGray.hpp"
 #include "ofxOpenCv.h"
 #include "ofxCv.h"
 
@@ -13,11 +14,28 @@ namespace ImageProcessing
     // shared values
     static ofxCvGrayscaleImage  cvGrayImg;
     static ofxCvContourFinder   cvContourFinder;
-    
+
     static void clonePixels(const ofPixels& src, ofPixels& dst)
     {
         dst.setFromPixels(src.getPixels(), src.getWidth(), src.getHeight(), src.getNumChannels());
     }
+
+    static void allocateIfNeeded(ofPixels& pix, int w, int h, int ch)
+    {
+        if (pix.isAllocated() == false ||
+            pix.getWidth() != w || pix.getHeight() != h || pix.getNumChannels() != ch)
+        {
+            pix.allocate(w, h, ch);
+        }
+    }
+
+    // copy into dst, which is only allocated again when the format changed
+    static void copyPixels(const ofPixels& src, ofPixels& dst)
+    {
+        if (src.isAllocated() == false) return;
+        allocateIfNeeded(dst, src.getWidth(), src.getHeight(), src.getNumChannels());
+        memcpy(dst.getPixels(), src.getPixels(), src.getWidth() * src.getHeight() * src.getNumChannels());
+    }
     
     static void resize(ofPixels& pix, int width, int height)
     {
@@ -60,8 +78,9 @@ namespace ImageProcessing
     
     static void warpPerspective(ofPixels& src, ofPixels& dst, const double vecX, const double vecY)
     {
+        allocateIfNeeded(dst, src.getWidth(), src.getHeight(), src.getNumChannels());
         cv::Mat img_src = toCv(src);
-        cv::Mat img_dst;
+        cv::Mat img_dst = toCv(dst);
         const double w = src.getWidth();
         const double h = src.getHeight();
         cv::Point2f src_pt[4], dst_pt[4];
@@ -78,32 +97,45 @@ namespace ImageProcessing
         
         const cv::Mat homography_matrix = cv::getPerspectiveTransform(src_pt, dst_pt);
         cv::warpPerspective(img_src, img_dst, homography_matrix,img_src.size());
-        toOf(img_dst, dst);
-    }
-    
-    static void warpPerspective(ofPixels& pix, const double vecX, const double vecY)
-    {
-        ofPixels dst;
-        warpPerspective(pix, dst, vecX, vecY);
-        pix.swap(dst);
     }
     
     static void rgbToGray(const ofPixels& pix, ofPixels& dst)
     {
-        const int w = pix.getWidth();
-        const int h = pix.getHeight();
-        dst.allocate(w, h, 1);
+        const int w  = pix.getWidth();
+        const int h  = pix.getHeight();
+        const int ch = pix.getNumChannels();
+        allocateIfNeeded(dst, w, h, 1);
+        if (ch == 3)
+        {
+            gray::convertRow(pix.getPixels(), dst.getPixels(), w * h);
+            return;
+        }
         for (int i = 0; i < w * h; ++i)
         {
-            dst[i] = (pix[i*3+0] * 0.298912) + (pix[i*3+1] * 0.586611) + (pix[i*3+2] * 0.114478);
+            dst[i] = ch > 3 ? gray::toGray(&pix[i * ch]) : pix[i * ch];
         }
     }
     
-    static void rgbToGray(ofPixels& pix)
+    // converts only the rows [rowBegin, rowEnd) into the full size dst
+    static void rgbToGray(const ofPixels& pix, ofPixels& dst, int rowBegin, int rowEnd)
     {
-        ofPixels dst;
-        rgbToGray(pix, dst);
-        pix.swap(dst);
+        const int w  = pix.getWidth();
+        const int ch = pix.getNumChannels();
+        allocateIfNeeded(dst, w, pix.getHeight(), 1);
+        for (int y = rowBegin; y < rowEnd; ++y)
+        {
+            const unsigned char* spx = pix.getPixels() + y * w * ch;
+            unsigned char* dpx = dst.getPixels() + y * w;
+            if (ch == 3)
+            {
+                gray::convertRow(spx, dpx, w);
+                continue;
+            }
+            for (int x = 0; x < w; ++x)
+            {
+                dpx[x] = ch > 3 ? gray::toGray(spx + x * ch) : spx[x * ch];
+            }
+        }
     }
     
     static void thresholdOtsu(ofPixels& pix)
@@ -114,10 +146,10 @@ namespace ImageProcessing
     
     static void thresholdOtsu(ofPixels& src, ofPixels& dst)
     {
+        allocateIfNeeded(dst, src.getWidth(), src.getHeight(), 1);
         cv::Mat img_src = toCv(src);
-        cv::Mat img_dst;
+        cv::Mat img_dst = toCv(dst);
         cv::threshold(img_src, img_dst, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
-        toOf(img_dst, dst);
     }
     
     static void threshold(ofPixels& pix, double th)
@@ -128,13 +160,13 @@ namespace ImageProcessing
     
     static void threshold(ofPixels& src, ofPixels& dst, double th)
     {
-        // TODO: no update src image
+        allocateIfNeeded(dst, src.getWidth(), src.getHeight(), 1);
         cv::Mat img_src = toCv(src);
         cv::Mat img_dst = toCv(dst);
         cv::threshold(img_src, img_dst, th, 255, cv::THRESH_BINARY_INV);
-//        toOf(img_dst, dst);
     }
 
+
     
     
     
@@ -188,14 +220,7 @@ namespace ImageProcessing
     {
         const int w = srcPixRef.getWidth();
         const int h = srcPixRef.getHeight();
-        
-        if (dstPixRef.isAllocated() == false ||
-            srcPixRef.getWidth()  != dstPixRef.getWidth() ||
-            srcPixRef.getHeight() != dstPixRef.getWidth() ||
-            dstPixRef.getImageType() != OF_IMAGE_GRAYSCALE)
-        {
-            dstPixRef.allocate(w, h, OF_IMAGE_GRAYSCALE);
-        }
+        allocateIfNeeded(dstPixRef, w, h, 1);
         
         unsigned char* spx = srcPixRef.getPixels();
         unsigned char* dpx = dstPixRef.getPixels();
@@ -215,6 +240,94 @@ namespace ImageProcessing
             else dpx[i] = 255;
         }
     }
+
+    // crop rect of the downscaled frame (rw x rh) from normalized corners, at least 1px
+    static void getCropRect(int rw, int rh, const ofVec2f& xy1, const ofVec2f& xy2,
+                            int& x1, int& y1, int& x2, int& y2)
+    {
+        x1 = ofClamp(xy1.x * rw, 0, rw - 1);
+        y1 = ofClamp(xy1.y * rh, 0, rh - 1);
+        x2 = ofClamp(xy2.x * rw, x1 + 1, rw);
+        y2 = ofClamp(xy2.y * rh, y1 + 1, rh);
+    }
+
+    /**
+     *  flip -> rgbToGray -> resize -> limitBrightness for the rect (x, y, w, h)
+     *  of the downscaled frame. Each output pixel averages its ratio x ratio source block.
+     */
+    static void fusedFrontEndRect(const ofPixels& src, int ratio, bool flipH, bool flipV, int blackThreshold,
+                                  int x, int y, int w, int h, unsigned char* dst, int dstStride)
+    {
+        const int sw = src.getWidth();
+        const int sh = src.getHeight();
+        const int ch = src.getNumChannels();
+        const unsigned char* spx = src.getPixels();
+        const unsigned int denom = (ratio * ratio) << GRAY_SHIFT;
+        const unsigned int half  = denom >> 1;
+
+        if (ratio == 1 && flipH == false && ch == 3)
+        {
+            // rows are contiguous, use the vectorized converter
+            for (int j = 0; j < h; ++j)
+            {
+                const int sy = flipV ? sh - 1 - (y + j) : y + j;
+                unsigned char* out = dst + j * dstStride;
+                gray::convertRow(spx + (sy * sw + x) * 3, out, w);
+                for (int i = 0; i < w; ++i)
+                {
+                    if (out[i] >= blackThreshold) out[i] = 255;
+                }
+            }
+            return;
+        }
+
+        for (int j = 0; j < h; ++j)
+        {
+            // a block of the flipped frame starts at the mirrored source coordinate
+            const int ry = y + j;
+            const int sy = flipV ? sh - (ry + 1) * ratio : ry * ratio;
+            unsigned char* out = dst + j * dstStride;
+
+            for (int i = 0; i < w; ++i)
+            {
+                const int rx = x + i;
+                const int sx = flipH ? sw - (rx + 1) * ratio : rx * ratio;
+                unsigned int sum = 0;
+                for (int ky = 0; ky < ratio; ++ky)
+                {
+                    const unsigned char* p = spx + ((sy + ky) * sw + sx) * ch;
+                    if (ch >= 3)
+                    {
+                        for (int kx = 0; kx < ratio; ++kx, p += ch)
+                        {
+                            sum += p[0] * GRAY_COEF_R + p[1] * GRAY_COEF_G + p[2] * GRAY_COEF_B;
+                        }
+                    }
+                    else {
+                        for (int kx = 0; kx < ratio; ++kx, p += ch)
+                        {
+                            sum += p[0] << GRAY_SHIFT;
+                        }
+                    }
+                }
+                const int v = (sum + half) / denom;
+                out[i] = v < blackThreshold ? v : 255;
+            }
+        }
+    }
+
+    // flip, rgbToGray, resize and limitBrightness of the whole frame in one pass (crop preview)
+    static void fusedFrontEnd(const ofPixels& src, ofPixels& limitedDst,
+                              bool flipH, bool flipV, int ratio, int blackThreshold)
+    {
+        ratio = MAX(ratio, 1);
+        const int rw = src.getWidth()  / ratio;
+        const int rh = src.getHeight() / ratio;
+        if (rw == 0 || rh == 0) return;
+        allocateIfNeeded(limitedDst, rw, rh, 1);
+        fusedFrontEndRect(src, ratio, flipH, flipV, blackThreshold,
+                          0, 0, rw, rh, limitedDst.getPixels(), rw);
+    }
 }
 
 namespace imp = ImageProcessing;
@@ -1,45 +1,30 @@
 #include "InputImageController.h"
 
-template<typename ofxCvImageType>
-void setCvImageFromPixels(ofxCvImageType& cvImage, ofPixels& pix)
-{
-    if (cvImage.getWidth() != pix.getWidth() || cvImage.getHeight() != pix.getHeight())
-    {
-        cvImage.allocate(pix.getWidth(), pix.getHeight());
-    }
-    cvImage.setFromPixels(pix);
-}
-
-template<typename ofxCvImageType>
-void warpPerspective(ofxCvImageType& cvImage, const double vecX, const double vecY)
-{
-    const double w = cvImage.getWidth();
-    const double h = cvImage.getHeight();
-    ofPoint dst_pt[4];
-    dst_pt[0] = ofPoint( (vecX > 0 ? 0.0  : -vecX     ), (vecY > 0 ? 0.0  : -vecY   ) );
-    dst_pt[1] = ofPoint( (vecX > 0 ? w : w+vecX       ), (vecY > 0 ? vecY    : 0.0  ) );
-    dst_pt[2] = ofPoint( (vecX > 0 ? w-vecX     : w  ), (vecY > 0 ? h-vecY      : h) );
-    dst_pt[3] = ofPoint( (vecX > 0 ? vecX    : 0.0    ), (vecY > 0 ? h : h+vecY     ) );
-    cvImage.warpPerspective(dst_pt[0], dst_pt[1], dst_pt[2], dst_pt[3]);
-}
-
-
 
-InputVideoController::InputVideoController(const string& videoPath)
+InputVideoController::InputVideoController(const string& videoPath, bool bGray)
 : mVideoPath(videoPath)
+, bGray(bGray)
 {
     setup();
 }
 
 void InputVideoController::setup()
 {
+    // the pipeline only looks at luma: a mono frame skips the color conversion and rgbToGray,
+    // and is a third of the bytes to copy
+    basePlayer::setPixelFormat(bGray ? OF_PIXELS_MONO : OF_PIXELS_RGB);
     if (loadMovie(mVideoPath) == false)
     {
         LOG_ERROR << "failed load movie: " << mVideoPath;
         return;
     }
+    if (bGray && basePlayer::getPixelFormat() != OF_PIXELS_MONO)
+    {
+        LOG_WARNING << "the video player can not decode to luma only, falling back to RGB: " << mVideoPath;
+    }
     basePlayer::setVolume(0);
-    allocateAllPixelsAndTextures(basePlayer::getWidth(), basePlayer::getHeight());
+    // only the pixels are used, the stage textures are uploaded on request
+    basePlayer::setUseTexture(false);
 }
 
 void InputVideoController::update()
@@ -47,8 +32,9 @@ void InputVideoController::update()
     basePlayer::update();
     if (isFrameNew())
     {
-        preProcess(basePlayer::getPixelsRef());
+        submitFrame(basePlayer::getPixelsRef());
     }
+    receiveFrame();
 }
 
 void InputVideoController::play()
@@ -68,16 +54,68 @@ void InputVideoController::togglePlay()
 
 
 
-InputCameraController::InputCameraController(int w, int h, int deviceId)
+InputFileController::InputFileController(const string& path, float fps)
+: mPath(path)
+, mFps(fps)
+{
+    setup();
+}
+
+void InputFileController::setup()
+{
+    if (load(mPath) == false)
+    {
+        LOG_ERROR << "failed load frame file: " << mPath;
+        return;
+    }
+    basePlayer::setFrameRate(mFps);
+    basePlayer::setLoop(true);
+    basePlayer::play();
+}
+
+void InputFileController::update()
+{
+    basePlayer::update();
+    if (isFrameNew())
+    {
+        submitFrame(basePlayer::getPixelsRef());
+    }
+    receiveFrame();
+}
+
+void InputFileController::play()
+{
+    basePlayer::play();
+}
+
+void InputFileController::stop()
+{
+    basePlayer::stop();
+}
+
+void InputFileController::togglePlay()
+{
+    basePlayer::isPlaying() ? stop() : play();
+}
+
+
+
+InputCameraController::InputCameraController(int w, int h, int deviceId, bool bGray, const string& fakeDevicePath)
 : mWidth(w)
 , mHeight(h)
 , mDeviceId(deviceId)
+, bGray(bGray)
+, mFakeDevicePath(fakeDevicePath)
 {
     setup();
 }
 
 void InputCameraController::setup()
 {
+    if (mFakeDevicePath.empty() == false)
+    {
+        baseGrabber::setGrabber(ofPtr<ofBaseVideoGrabber>(new FileVideoGrabber(mFakeDevicePath)));
+    }
     vector<ofVideoDevice> devices = listDevices();
     
     cout << "~~~~~~~~~~ CAMERA DEVICE ~~~~~~~~~~" << endl;
@@ -91,8 +129,15 @@ void InputCameraController::setup()
     }
     cout << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~" << endl;
     baseGrabber::setDeviceID(mDeviceId);
-    baseGrabber::initGrabber(mWidth, mHeight, true);
-    allocateAllPixelsAndTextures(baseGrabber::getWidth(), baseGrabber::getHeight());
+    // webcams deliver YUYV / NV12, taking the Y plane as is skips the RGB conversion
+    // and rgbToGray; the flip happens in the remap, which reads the luma directly
+    baseGrabber::setPixelFormat(bGray ? OF_PIXELS_MONO : OF_PIXELS_RGB);
+    // only the pixels are used, the stage textures are uploaded on request
+    baseGrabber::initGrabber(mWidth, mHeight, false);
+    if (bGray && baseGrabber::getPixelFormat() != OF_PIXELS_MONO)
+    {
+        LOG_WARNING << "the camera can not deliver luma only, falling back to RGB";
+    }
 }
 
 void InputCameraController::update()
@@ -100,8 +145,9 @@ void InputCameraController::update()
     baseGrabber::update();
     if (isFrameNew())
     {
-        preProcess(baseGrabber::getPixelsRef());
+        submitFrame(baseGrabber::getPixelsRef());
     }
+    receiveFrame();
 }
 
 void InputCameraController::play()
@@ -2,35 +2,181 @@
 
 #include "ofMain.h"
 #include "ImageProcessing.hpp"
+#include "RemapTransform.hpp"
+#include "FrameArena.hpp"
+#include "BinaryMask.hpp"
+#include "ContourTracer.h"
+#include "TileChangeDetector.hpp"
+#include "MaskStages.hpp"
+#include "PhaseTimer.hpp"
+#include "RawFrameFile.hpp"
+#include "FileVideoGrabber.hpp"
+#include "AllocationCounter.h"
+#include "constants.h"
+#include "utils.h"
+#include "../../common/TripleBuffer.hpp"
+#include "../../common/LatestFrameQueue.hpp"
+#include <thread>
+#include <mutex>
 #include "ofxOpenCv.h"
 
+/**
+ *  One finished frame of the vision pipeline. The worker fills a copy and
+ *  publishes it, the GL thread reads and uploads it.
+ */
+struct VisionFrame
+{
+    ofPixels        limitedPix, warpedPix, binaryPix;
+    ContourSet      contours;
+    unsigned long   contourFrame;
+    int             numDirtyTiles, numTiles;
+    int             resizedWidth, resizedHeight;
+    bool            bLimited;       // limitedPix is from this frame (the preview was enabled)
+    PhaseTimer::Clock::time_point captureTime;
+    
+    VisionFrame()
+    : contourFrame(0), numDirtyTiles(0), numTiles(0), resizedWidth(0), resizedHeight(0), bLimited(false)
+    {}
+};
+
+
+/**
+ *  The GUI parameters of the pipeline, copied on the GL thread with every
+ *  frame: the worker reads only this copy, never the ofParameters that
+ *  ofxGui writes while it runs.
+ */
+struct VisionSettings
+{
+    int     resizeRatio;
+    bool    flipH, flipV;
+    float   cropX1, cropY1, cropX2, cropY2;
+    float   warpX, warpY;
+    int     blackThreshold;
+    float   blobThreshold;
+    bool    adaptive;
+    int     adaptiveRadius, adaptiveOffset;
+    bool    changeDetection;
+    int     changeNoiseFloor;
+    bool    incremental;
+    int     maskOpen, maskClose, maskErode, maskDilate;     // iterations of the mask stages
+    
+    // the remap table and the stage buffers follow these
+    bool isSameGeometry(const VisionSettings& o) const
+    {
+        return resizeRatio == o.resizeRatio && flipH == o.flipH && flipV == o.flipV
+            && cropX1 == o.cropX1 && cropY1 == o.cropY1 && cropX2 == o.cropX2 && cropY2 == o.cropY2
+            && warpX == o.warpX && warpY == o.warpY && adaptive == o.adaptive;
+    }
+    
+    // a change of these reprocesses the next frame even if it looks the same
+    bool isSameProcessing(const VisionSettings& o) const
+    {
+        return blobThreshold == o.blobThreshold && adaptive == o.adaptive && adaptiveRadius == o.adaptiveRadius
+            && adaptiveOffset == o.adaptiveOffset && changeDetection == o.changeDetection && incremental == o.incremental
+            && maskOpen == o.maskOpen && maskClose == o.maskClose && maskErode == o.maskErode
+            && maskDilate == o.maskDilate;
+    }
+};
+
+/// a captured frame with the settings it is processed with
+struct VisionInput
+{
+    ofPixels        pixels;
+    VisionSettings  settings;
+};
+
+
 class BaseImagesInterface
 {
 protected:
-    ofPixels    mFlipedPix, mGrayPix, mResizedPix, mLimitedPix, mCropedPix, mWarpedPix, mBinaryPix;
-    ofTexture   mFlipedTex, mGrayTex, mResizedTex, mLimitedTex, mCropedTex, mWarpedTex, mBinaryTex;
+    /**
+     *  Debug view of one stage. It is uploaded from the front frame only when
+     *  it is asked for, allocated on the first request and released again
+     *  after TEXTURE_RELEASE_FRAMES frames without one.
+     */
+    struct StageTexture
+    {
+        ofTexture       tex;
+        unsigned long   uploadedFrame;  // mFrameSerial of the pixels in tex, 0 for none
+        unsigned long   lastRequest;    // ofGetFrameNum() of the last request
+        
+        StageTexture() : uploadedFrame(0), lastRequest(0) {}
+    };
+    
+    TripleBuffer<VisionFrame>   mFrames;
+    unsigned long           mFrameSerial;       // counts the frames taken from mFrames
+    StageTexture            mLimitedTex, mWarpedTex, mBinaryTex;
+    std::atomic<bool>       bPreview;
+    
+    ContourFinderAdapter    mContourFinder;
+    bool                    bContourFinderDirty;
+    std::atomic<bool>       bProcessDirty;      // process the next frame even if it did not change
+    
+    ofTexture& requestTexture(StageTexture& st, const ofPixels& pix)
+    {
+        st.lastRequest = ofGetFrameNum();
+        if (st.uploadedFrame != mFrameSerial && pix.isAllocated())
+        {
+            if (st.tex.isAllocated() == false || pix.getWidth() != st.tex.getWidth() || pix.getHeight() != st.tex.getHeight())
+            {
+                st.tex.allocate(pix.getWidth(), pix.getHeight(), pix.getNumChannels() == 1 ? GL_LUMINANCE : GL_RGB);
+            }
+            st.tex.loadData(pix);
+            st.uploadedFrame = mFrameSerial;
+        }
+        return st.tex;
+    }
     
-    ofxCvColorImage         mCvImage;
-    ofxCvGrayscaleImage     mCvGrayImage;
-    ofxCvContourFinder      mContourFinder;
+    void releaseTextureIfUnused(StageTexture& st)
+    {
+        if (st.tex.isAllocated() && ofGetFrameNum() - st.lastRequest > TEXTURE_RELEASE_FRAMES)
+        {
+            st.tex.clear();
+            st.uploadedFrame = 0;
+        }
+    }
     
 public:
+    BaseImagesInterface() : mFrameSerial(0), bPreview(false), bContourFinderDirty(true), bProcessDirty(true) {}
+    
+    // the full downscaled frame (mLimitedPix) is only produced while the preview is enabled
+    void setPreviewEnabled(bool b)
+    {
+        if (b && bPreview == false) bProcessDirty = true;
+        bPreview = b;
+    }
+    
+    // everything below is the latest finished frame, it only changes in update()
+    ofPixels& getLimitedPixRef()      { return mFrames.getFront().limitedPix; }
+    ofPixels& getWarpedPixelsRef()    { return mFrames.getFront().warpedPix;  }
+    ofPixels& getBinaryPixelsRef()    { return mFrames.getFront().binaryPix;  }
+    
+    // GL thread only, the pixels of the front frame are uploaded on the first call after update()
+    ofTexture& getLimitedTexRef()     { return requestTexture(mLimitedTex, getLimitedPixRef());   }
+    ofTexture& getWarpedTextureRef()  { return requestTexture(mWarpedTex,  getWarpedPixelsRef()); }
+    ofTexture& getBinaryTextureRef()  { return requestTexture(mBinaryTex,  getBinaryPixelsRef()); }
+    
+    const ContourSet& getContourSet() const { return mFrames.getFront().contours; }
+    
+    // counts up every time the contours are found again (unchanged frames are skipped)
+    unsigned long getContourFrame() const { return mFrames.getFront().contourFrame; }
     
-    ofPixels& getGrayPixelsRef()      { return mGrayPix;    }
-    ofPixels& getResizedPixelsRef()   { return mResizedPix; }
-    ofPixels& getLimitedPixRef()      { return mLimitedPix; }
-    ofPixels& getCropedPixelsRef()    { return mCropedPix;  }
-    ofPixels& getWarpedPixelsRef()    { return mWarpedPix;  }
-    ofPixels& getBinaryPixelsRef()    { return mBinaryPix;  }
-    
-    ofTexture& getGrayTextureRef()    { return mGrayTex;    }
-    ofTexture& getResizedTextureRef() { return mResizedTex; }
-    ofTexture& getLimitedTexRef()     { return mLimitedTex; }
-    ofTexture& getCropedTextureRef()  { return mCropedTex;  }
-    ofTexture& getWarpedTextureRef()  { return mWarpedTex;  }
-    ofTexture& getBinaryTextureRef()  { return mBinaryTex;  }
-    
-    ofxCvContourFinder& getCvContourFinder() { return mContourFinder; }
+    // when the source frame of the contours was handed to the pipeline
+    PhaseTimer::Clock::time_point getCaptureTime() const { return mFrames.getFront().captureTime; }
+    
+    int getNumDirtyTiles() const { return mFrames.getFront().numDirtyTiles; }
+    int getNumTiles() const      { return mFrames.getFront().numTiles; }
+    
+    // legacy view of the contours, converted on the first call after each frame
+    ofxCvContourFinder& getCvContourFinder()
+    {
+        if (bContourFinderDirty)
+        {
+            mContourFinder.setFromContours(getContourSet());
+            bContourFinderDirty = false;
+        }
+        return mContourFinder;
+    }
 };
 
 
@@ -50,8 +196,52 @@ protected:
     ofParameter<float>      mWarpX;
     ofParameter<float>      mWarpY;
     ofParameter<float>      mBlobThreshold;
+    ofParameter<bool>       mAdaptive;
+    ofParameter<int>        mAdaptiveRadius;
+    ofParameter<int>        mAdaptiveOffset;
+    ofParameter<int>        mMaskOpen;
+    ofParameter<int>        mMaskClose;
+    ofParameter<int>        mMaskErode;
+    ofParameter<int>        mMaskDilate;
+    ofParameter<string>     mMaskStageList;
+    ofParameter<bool>       mChangeDetection;
+    ofParameter<int>        mChangeNoiseFloor;
+    ofParameter<bool>       mIncremental;
     ofParameter<int>        mMaxNumBlobs;
     
+    // worker side of the pipeline, see processFrame()
+    ofPixels                mGrayPix, mLimitedPix, mWarpedPix, mBinaryPix;
+    vector<unsigned int>    mIntegral;      // summed-area table of mWarpedPix for the adaptive threshold
+    VisionSettings          mSettings;      // of the frame in process
+    bool                    bSettingsValid;
+    RemapTransform          mRemap;
+    FrameArena              mArena;
+    bool                    bRelayouted;
+    std::atomic<unsigned long> mFrameAllocations;
+    TileChangeDetector      mChangeDetector;
+    std::atomic<unsigned long> mNumProcessedFrames;
+    std::atomic<unsigned long> mNumSkippedFrames;
+    ContourTracer           mContourTracer;
+    unsigned long           mContourFrame;
+    BinaryMask              mBinaryMask;
+    BinaryMask              mRawMask;       // thresholded only, kept to redo the mask stages of a row band
+    BinaryMask              mWorkMask;
+    MaskStageGraph          mMaskStages;
+    std::mutex              mStageListMutex;
+    string                  mPendingStageList;
+    std::atomic<bool>       bStagesDirty;
+    int                     mLayoutChannels;
+    int                     mChangedBegin, mChangedEnd;     // rows of mWarpedPix to process this frame
+    int                     mFramesSinceFullPass;
+    
+    // frames handed to the worker thread, the newest one wins
+    std::thread             mWorker;
+    LatestFrameQueue<VisionInput> mInputQueue;
+    std::atomic<unsigned long> mNumCapturedFrames;
+    
+    // capture side recording of the source frames
+    std::unique_ptr<RawFrameRecorder> mRecorder;    // while recording
+    
     void setupGui()
     {
         static int idx = 1;
@@ -66,120 +256,371 @@ protected:
         mParamGroup.add(mWarpX.set("WARP_X" + idxStr, 0, -180, 180));
         mParamGroup.add(mWarpY.set("WARP_Y" + idxStr, 0, -180, 180));
         mParamGroup.add(mBlobThreshold.set("THRESHOLD", 127, 0, 255));
+        mParamGroup.add(mAdaptive.set("ADAPTIVE_THRESHOLD" + idxStr, false));
+        mParamGroup.add(mAdaptiveRadius.set("ADAPTIVE_RADIUS" + idxStr, 8, 1, 64));
+        mParamGroup.add(mAdaptiveOffset.set("ADAPTIVE_OFFSET" + idxStr, 15, 0, 50));
+        mParamGroup.add(mMaskOpen.set("MASK_OPEN" + idxStr, 0, 0, 3));
+        mParamGroup.add(mMaskClose.set("MASK_CLOSE" + idxStr, 0, 0, 3));
+        mParamGroup.add(mMaskErode.set("MASK_ERODE" + idxStr, 0, 0, 3));
+        mParamGroup.add(mMaskDilate.set("MASK_DILATE" + idxStr, 0, 0, 3));
+        mParamGroup.add(mMaskStageList.set("MASK_STAGES" + idxStr, "open,close"));
+        mParamGroup.add(mChangeDetection.set("SKIP_UNCHANGED" + idxStr, true));
+        mParamGroup.add(mChangeNoiseFloor.set("CHANGE_NOISE_FLOOR" + idxStr, 4, 0, 32));
+        mParamGroup.add(mIncremental.set("INCREMENTAL" + idxStr, true));
         idx++;
+        
+        // the other parameters reach the worker with each frame, see getSettings()
+        mMaskStageList.addListener(this, &InputImageController::changedMaskStages);
     }
     
-    void allocatePixels(ofPixels& pix, int w, int h, int ch)
+    /// GL thread: the parameters for the next frame
+    VisionSettings getSettings() const
     {
-        pix.allocate(w, h, ch);
+        VisionSettings s;
+        s.resizeRatio       = mResizeRatio;
+        s.flipH             = mFlipH;
+        s.flipV             = mFlipV;
+        s.cropX1            = mCropXY1->x;
+        s.cropY1            = mCropXY1->y;
+        s.cropX2            = mCropXY2->x;
+        s.cropY2            = mCropXY2->y;
+        s.warpX             = mWarpX;
+        s.warpY             = mWarpY;
+        s.blackThreshold    = mBlackThreshold;
+        s.blobThreshold     = mBlobThreshold;
+        s.adaptive          = mAdaptive;
+        s.adaptiveRadius    = mAdaptiveRadius;
+        s.adaptiveOffset    = mAdaptiveOffset;
+        s.changeDetection   = mChangeDetection;
+        s.changeNoiseFloor  = mChangeNoiseFloor;
+        s.incremental       = mIncremental;
+        s.maskOpen          = mMaskOpen;
+        s.maskClose         = mMaskClose;
+        s.maskErode         = mMaskErode;
+        s.maskDilate        = mMaskDilate;
+        return s;
     }
     
-    void allocateTexture(ofTexture& tex, int w, int h, int ch)
+    // the list is handed to the worker, which rebuilds the graph before its next frame
+    void changedMaskStages(string& e)
     {
-        tex.allocate(w, h, ch == 1 ? GL_LUMINANCE : GL_RGB);
+        std::lock_guard<std::mutex> lock(mStageListMutex);
+        mPendingStageList = e;
+        bStagesDirty = true;
+        bProcessDirty = true;
     }
     
-    template<typename ofxCvImageType>
-    void setCvImageFromPixels(ofxCvImageType& cvImage, ofPixels& pix)
+    void registerMaskStages()
     {
-        if (cvImage.getWidth() != pix.getWidth() || cvImage.getHeight() != pix.getHeight())
+        // the stages read their iterations from the settings of the frame in process
+        mMaskStages.registerStage("open",   [this]{ return new MorphologyStage(MorphologyStage::OPEN,   mSettings.maskOpen);   });
+        mMaskStages.registerStage("close",  [this]{ return new MorphologyStage(MorphologyStage::CLOSE,  mSettings.maskClose);  });
+        mMaskStages.registerStage("erode",  [this]{ return new MorphologyStage(MorphologyStage::ERODE,  mSettings.maskErode);  });
+        mMaskStages.registerStage("dilate", [this]{ return new MorphologyStage(MorphologyStage::DILATE, mSettings.maskDilate); });
+    }
+    
+    // the raw and work masks only exist while a mask stage is active
+    void allocateStageBuffers(bool bActive)
+    {
+        const int w = mRemap.getWidth();
+        const int h = mRemap.getHeight();
+        if (bActive && (mWorkMask.getWidth() != w || mWorkMask.getHeight() != h))
+        {
+            mRawMask.allocate(w, h);
+            mWorkMask.allocate(w, h);
+            bRelayouted = true;
+        }
+        else if (bActive == false && mWorkMask.isAllocated())
         {
-            cvImage.allocate(pix.getWidth(), pix.getHeight());
+            mRawMask.clear();
+            mWorkMask.clear();
         }
-        cvImage.setFromPixels(pix);
     }
     
-    void textureLoadData(ofPixels& pix, ofTexture& tex)
+    /**
+     *  True when the warped frame differs from the last processed one (or must be
+     *  processed anyway). mChangedBegin / mChangedEnd are set to the rows to process:
+     *  the band of dirty tiles when incremental, widened by the adaptive window,
+     *  otherwise the whole frame. Only those rows become the new reference.
+     *  The rows outside the band keep their mask, contours and reference, so
+     *  an incremental result is not exactly a full one: changes below the noise
+     *  floor are not seen there. After FULL_PASS_INTERVAL incremental frames the
+     *  next changed frame is processed whole, which bounds how long such a
+     *  difference lasts; skipped frames do not count, a still sheet stays idle.
+     */
+    bool detectChange(bool bProcessAll)
     {
-        if (pix.getWidth() != tex.getWidth() || pix.getHeight() != tex.getHeight())
+        bool bFull = bProcessAll || mSettings.changeDetection == false || mSettings.incremental == false;
+        mChangedBegin = 0;
+        mChangedEnd = mWarpedPix.getHeight();
+        if (mSettings.changeDetection == false)
+        {
+            mChangeDetector.invalidate();
+            return true;
+        }
+        
+        const bool bDirty = mChangeDetector.update(mWarpedPix, mSettings.changeNoiseFloor) > 0;
+        if (bFull == false)
         {
-            allocateTexture(tex, pix.getWidth(), pix.getHeight(), pix.getNumChannels());
+            if (bDirty == false) return false;
+            bFull = mFramesSinceFullPass >= FULL_PASS_INTERVAL;
         }
-        tex.loadData(pix);
+        if (bFull)
+        {
+            mFramesSinceFullPass = 0;
+        }
+        else
+        {
+            mFramesSinceFullPass++;
+            mChangeDetector.getDirtyRows(mChangedBegin, mChangedEnd);
+            if (mSettings.adaptive)
+            {
+                mChangedBegin = MAX(0, mChangedBegin - mSettings.adaptiveRadius);
+                mChangedEnd = MIN((int)mWarpedPix.getHeight(), mChangedEnd + mSettings.adaptiveRadius);
+            }
+        }
+        mChangeDetector.accept(mWarpedPix, mChangedBegin, mChangedEnd);
+        return true;
     }
     
-    template<typename ofxCvImageType>
-    void warpPerspective(ofxCvImageType& cvImage, const double vecX, const double vecY)
+    void allocatePixels(ofPixels& pix, int w, int h, int ch)
     {
-        const double w = cvImage.getWidth();
-        const double h = cvImage.getHeight();
-        ofPoint src_pt[4];
-        src_pt[0] = ofPoint( (vecX > 0 ? 0.0  : -vecX     ), (vecY > 0 ? 0.0  : -vecY   ) );
-        src_pt[1] = ofPoint( (vecX > 0 ? w : w+vecX       ), (vecY > 0 ? vecY    : 0.0  ) );
-        src_pt[2] = ofPoint( (vecX > 0 ? w-vecX     : w   ), (vecY > 0 ? h-vecY      : h) );
-        src_pt[3] = ofPoint( (vecX > 0 ? vecX    : 0.0    ), (vecY > 0 ? h : h+vecY     ) );
-        cvImage.warpPerspective(src_pt[0], src_pt[1], src_pt[2], src_pt[3]);
+        pix.allocate(w, h, ch);
     }
     
-    void warpPerspective(ofxCvImage* cvImagePre, const double vecW, const double vecH)
+    // stage pixels are views into mArena, laid out again whenever the geometry changes;
+    // the gray frame and the summed-area table only get memory when their stage runs
+    void layoutPixels(int srcChannels)
     {
-        const double w = cvImagePre->getWidth();
-        const double h = cvImagePre->getHeight();
-        ofPoint src_pt[4];
-        src_pt[0] = ofPoint( (vecW > 0 ? 0.0  : -vecW     ), (vecH > 0 ? 0.0  : -vecH   ) );
-        src_pt[1] = ofPoint( (vecW > 0 ? w : w+vecW       ), (vecH > 0 ? vecH    : 0.0  ) );
-        src_pt[2] = ofPoint( (vecW > 0 ? w-vecW     : w   ), (vecH > 0 ? h-vecH      : h) );
-        src_pt[3] = ofPoint( (vecW > 0 ? vecW    : 0.0    ), (vecH > 0 ? h : h+vecH     ) );
-        cvImagePre->warpPerspective(src_pt[0], src_pt[1], src_pt[2], src_pt[3]);
+        const int rw = mRemap.getResizedWidth();
+        const int rh = mRemap.getResizedHeight();
+        mArena.begin();
+        if (srcChannels != 1) mArena.add(mGrayPix, mRemap.getSrcWidth(), mRemap.getSrcHeight(), 1);
+        if (rw > 0 && rh > 0) mArena.add(mLimitedPix, rw, rh, 1);
+        if (mRemap.isAllocated())
+        {
+            mArena.add(mWarpedPix, mRemap.getWidth(), mRemap.getHeight(), 1);
+            mArena.add(mBinaryPix, mRemap.getWidth(), mRemap.getHeight(), 1);
+            mBinaryMask.allocateIfNeeded(mRemap.getWidth(), mRemap.getHeight());
+            if (mSettings.adaptive)
+            {
+                mIntegral.resize((mRemap.getWidth() + 1) * (mRemap.getHeight() + 1));
+            }
+            else
+            {
+                vector<unsigned int>().swap(mIntegral);
+            }
+            mChangeDetector.allocate(mRemap.getWidth(), mRemap.getHeight());
+        }
+        mArena.end();
+        mLayoutChannels = srcChannels;
     }
     
-    void allocateAllPixelsAndTextures(int w, int h)
+    // returns true when new contours were found
+    bool preProcess(const ofPixels& srcPix, const VisionSettings& settings)
     {
-        allocatePixels(mFlipedPix, w, h, 3);
-        allocatePixels(mGrayPix, w, h, 1);
-        allocatePixels(mLimitedPix, w, h, 1);
-        allocatePixels(mResizedPix, w, h, 1);
-        allocatePixels(mCropedPix, w, h, 1);
-        allocatePixels(mWarpedPix, w, h, 1);
-        allocatePixels(mBinaryPix, w, h, 1);
+        const bool bGeometry = bSettingsValid == false || settings.isSameGeometry(mSettings) == false;
+        const bool bProcessAll = bProcessDirty.exchange(false) || bSettingsValid == false
+            || settings.isSameProcessing(mSettings) == false;
+        mSettings = settings;
+        bSettingsValid = true;
         
-        allocateTexture(mFlipedTex, w, h, 3);
-        allocateTexture(mGrayTex, w, h, 1);
-        allocateTexture(mLimitedTex, w, h, 1);
-        allocateTexture(mResizedTex, w, h, 1);
-        allocateTexture(mCropedTex, w, h, 1);
-        allocateTexture(mWarpedTex, w, h, 1);
-        allocateTexture(mBinaryTex, w, h, 1);
+        const int w = srcPix.getWidth();
+        const int h = srcPix.getHeight();
+        if (bGeometry || mRemap.getSrcWidth() != w || mRemap.getSrcHeight() != h
+            || mLayoutChannels != srcPix.getNumChannels())
+        {
+            mRemap.setup(w, h, mSettings.flipH, mSettings.flipV, mSettings.resizeRatio,
+                         ofVec2f(mSettings.cropX1, mSettings.cropY1), ofVec2f(mSettings.cropX2, mSettings.cropY2),
+                         mSettings.warpX, mSettings.warpY);
+            layoutPixels(srcPix.getNumChannels());
+            bRelayouted = true;
+        }
+        if (bStagesDirty.exchange(false))
+        {
+            std::lock_guard<std::mutex> lock(mStageListMutex);
+            mMaskStages.build(mPendingStageList);
+            bRelayouted = true;
+        }
+        
+        AllocationCounter::Scope allocScope;
+        PhaseTimer::Lap lap;
         
-        mCvImage.allocate(w, h);
-        mCvGrayImage.allocate(w, h);
+        // flip, resize, crop and warp in one resampling pass from the gray frame
+        const unsigned char* grayPx = srcPix.getPixels();
+        if (srcPix.getNumChannels() != 1)
+        {
+            imp::rgbToGray(srcPix, mGrayPix, mRemap.getRowBegin(), mRemap.getRowEnd());
+            grayPx = mGrayPix.getPixels();
+            lap.next(PhaseTimer::GRAY);
+        }
+        mRemap.apply(grayPx, mWarpedPix, mSettings.blackThreshold, mIntegral.empty() ? NULL : mIntegral.data());
+        lap.next(PhaseTimer::REMAP);
+        
+        // nothing moved on the paper: keep the last mask, contours and textures
+        const bool bChanged = detectChange(bProcessAll);
+        lap.next(PhaseTimer::CHANGE);
+        if (bChanged == false)
+        {
+            mNumSkippedFrames++;
+            return false;
+        }
+        mNumProcessedFrames++;
+        
+        if (bPreview)
+        {
+            imp::fusedFrontEnd(srcPix, mLimitedPix, mSettings.flipH, mSettings.flipV, mSettings.resizeRatio,
+                               mSettings.blackThreshold);
+            lap.next(PhaseTimer::PREVIEW);
+        }
+        
+        // ink as a packed 1bpp mask, straight into the final mask when no mask stage is active
+        const bool bMaskStages = mMaskStages.isIdentity() == false;
+        allocateStageBuffers(bMaskStages);
+        BinaryMask& thresholded = bMaskStages ? mRawMask : mBinaryMask;
+        if (mSettings.adaptive && mIntegral.empty() == false)
+        {
+            thresholded.thresholdAdaptive(mWarpedPix, mIntegral.data(), mSettings.adaptiveRadius,
+                                          mSettings.adaptiveOffset, mChangedBegin, mChangedEnd);
+        }
+        else
+        {
+            thresholded.threshold(mWarpedPix, mSettings.blobThreshold, mChangedBegin, mChangedEnd);
+        }
+        lap.next(PhaseTimer::THRESHOLD);
+        
+        // a change spreads by the reach of the stages: redo them on a band twice
+        // that wide so the inner band, which holds every changed row, is exact
+        const int maskH = mBinaryMask.getHeight();
+        const int reach = mMaskStages.getReach();
+        const int maskBegin = MAX(0, mChangedBegin - reach);
+        const int maskEnd   = MIN(maskH, mChangedEnd + reach);
+        if (bMaskStages)
+        {
+            const int workBegin = MAX(0, mChangedBegin - 2 * reach);
+            const int workEnd   = MIN(maskH, mChangedEnd + 2 * reach);
+            mWorkMask.copyRows(mRawMask, workBegin, workEnd);
+            mMaskStages.process(mWorkMask, workBegin, workEnd);
+            mBinaryMask.copyRows(mWorkMask, maskBegin, maskEnd);
+        }
+        mBinaryMask.unpack(mBinaryPix, maskBegin, maskEnd);
+        lap.next(PhaseTimer::MASK_STAGES);
+        
+        // the image stages above must not touch the heap once the layout is settled
+        mFrameAllocations = allocScope.get();
+        if (mFrameAllocations > 0 && bRelayouted == false)
+        {
+            LOG_ERROR << "image stages allocated " << mFrameAllocations << " times in a steady frame";
+            assert(false);
+        }
+        bRelayouted = false;
+        
+        mContourTracer.setDirtyRows(maskBegin, maskEnd);
+        mContourTracer.findContours(mBinaryMask, 1, 800*800, 127, true, true);
+        lap.next(PhaseTimer::CONTOURS);
+        mContourFrame++;
+        return true;
     }
     
-    void preProcess(const ofPixels& srcPix)
+    // worker: process one captured frame and publish it when it gave new contours
+    void processFrame(const ofPixels& srcPix, const VisionSettings& settings, PhaseTimer::Clock::time_point captureTime)
     {
-        imp::flip(srcPix, mFlipedPix, mFlipH, mFlipV);
-        imp::rgbToGray(mFlipedPix, mGrayPix);
-        imp::resize(mGrayPix, mResizedPix, srcPix.getWidth() / mResizeRatio, srcPix.getHeight() / mResizeRatio);
-        imp::limitBrightness(mResizedPix, mLimitedPix, mBlackThreshold);
-        imp::crop(mLimitedPix, mCropedPix,
-                  mCropXY1->x * mResizedPix.getWidth(), mCropXY1->y * mResizedPix.getHeight(),
-                  mCropXY2->x * mResizedPix.getWidth(), mCropXY2->y * mResizedPix.getHeight());
+        PhaseTimer::Scope timer(PhaseTimer::VISION);
+        PhaseTimer::record(PhaseTimer::QUEUE, PhaseTimer::Clock::now() - captureTime);
+        const bool bLimited = bPreview;
+        if (preProcess(srcPix, settings) == false) return;
         
-        setCvImageFromPixels(mCvGrayImage, mCropedPix);
-        warpPerspective(mCvGrayImage, mWarpX, mWarpY);
-        mWarpedPix.setFromPixels(mCvGrayImage.getPixels(), mCvGrayImage.getWidth(), mCvGrayImage.getHeight(), 1);
-        mCvGrayImage.threshold(mBlobThreshold);
-        mCvGrayImage.invert();
-        mBinaryPix.setFromPixels(mCvGrayImage.getPixels(), mCvGrayImage.getWidth(), mCvGrayImage.getHeight(), 1);
-        
-        mCvGrayImage.setFromPixels(mBinaryPix);
-        mContourFinder.findContours(mCvGrayImage, 1, 800*800, 127, true, true);
+        PhaseTimer::Scope publishTimer(PhaseTimer::PUBLISH);
+        VisionFrame& f = mFrames.getBack();
+        if (bLimited) imp::copyPixels(mLimitedPix, f.limitedPix);
+        imp::copyPixels(mWarpedPix, f.warpedPix);
+        imp::copyPixels(mBinaryPix, f.binaryPix);
+        f.contours      = mContourTracer;
+        f.contourFrame  = mContourFrame;
+        f.numDirtyTiles = mChangeDetector.getNumDirtyTiles();
+        f.numTiles      = mChangeDetector.getNumTiles();
+        f.resizedWidth  = mRemap.getResizedWidth();
+        f.resizedHeight = mRemap.getResizedHeight();
+        f.bLimited      = bLimited;
+        f.captureTime   = captureTime;
+        mFrames.publish();
+    }
+    
+    void workerLoop()
+    {
+        while (const LatestFrameQueue<VisionInput>::Entry* e = mInputQueue.waitPop())
+        {
+            processFrame(e->value.pixels, e->value.settings, e->captureTime);
+        }
+    }
+    
+    /**
+     *  Capture side: hand a new frame, with a copy of the parameters, to the vision worker. The frame is copied,
+     *  so the grabber can reuse its buffer right away; a frame that arrives
+     *  before the worker picked up the last one replaces it (and counts as dropped),
+     *  so a slow frame never delays the ones after it.
+     *  Without USE_VISION_THREAD the frame is processed right here.
+     */
+    void submitFrame(const ofPixels& srcPix)
+    {
+        const PhaseTimer::Clock::time_point captureTime = PhaseTimer::Clock::now();
+        mNumCapturedFrames++;
+        if (mRecorder) mRecorder->submit(srcPix, captureTime);
+#ifdef USE_VISION_THREAD
+        if (mWorker.joinable() == false)
+        {
+            mWorker = std::thread(&InputImageController::workerLoop, this);
+        }
+        const VisionSettings settings = getSettings();
+        mInputQueue.push([&](VisionInput& slot)
+        {
+            imp::copyPixels(srcPix, slot.pixels);
+            slot.settings = settings;
+        }, captureTime);
+#else
+        processFrame(srcPix, getSettings(), captureTime);
+#endif
+    }
+    
+    /// GL thread: take the latest finished frame, true if there was one (textures are uploaded on request)
+    bool receiveFrame()
+    {
+        releaseTextureIfUnused(mLimitedTex);
+        releaseTextureIfUnused(mWarpedTex);
+        releaseTextureIfUnused(mBinaryTex);
         
-        textureLoadData(mGrayPix,       mGrayTex);
-        textureLoadData(mResizedPix,    mResizedTex);
-        textureLoadData(mLimitedPix,    mLimitedTex);
-        textureLoadData(mCropedPix,     mCropedTex);
-        textureLoadData(mWarpedPix,     mWarpedTex);
-        textureLoadData(mBinaryPix,     mBinaryTex);
+        if (mFrames.update() == false) return false;
+        mFrameSerial++;
+        bContourFinderDirty = true;
+        return true;
     }
     
     
 public:
     InputImageController()
+    : bSettingsValid(false)
+    , bRelayouted(true)
+    , mFrameAllocations(0)
+    , mNumProcessedFrames(0)
+    , mNumSkippedFrames(0)
+    , mContourFrame(0)
+    , bStagesDirty(true)
+    , mLayoutChannels(0)
+    , mChangedBegin(0)
+    , mChangedEnd(0)
+    , mFramesSinceFullPass(0)
+    , mNumCapturedFrames(0)
     {
         setupGui();
+        registerMaskStages();
+        mPendingStageList = mMaskStageList;
+    }
+    
+    virtual ~InputImageController()
+    {
+        mInputQueue.close();
+        if (mWorker.joinable()) mWorker.join();
     }
-    virtual ~InputImageController() {}
     
     virtual void update()       = 0;
     virtual void play()         = 0;
@@ -188,6 +629,35 @@ public:
     
     void setThreshold(float th) { mBlobThreshold = th; }
     
+    // heap allocations of the image stages in the last frame (COUNT_FRAME_ALLOCATIONS only)
+    unsigned long getFrameAllocations() const { return mFrameAllocations; }
+    
+    // change detection statistics
+    unsigned long getNumProcessedFrames() const { return mNumProcessedFrames; }
+    unsigned long getNumSkippedFrames() const { return mNumSkippedFrames; }
+    
+    // frames handed over by the source, and those replaced by a newer one before the worker got to them
+    unsigned long getNumCapturedFrames() const { return mNumCapturedFrames; }
+    unsigned long getNumDroppedFrames() const { return mInputQueue.getNumDropped(); }
+    
+    /// write the source frames to a raw frame file from the next frame on, see RawFramePlayer
+    void startRecording(const string& path)
+    {
+        stopRecording();
+        mRecorder.reset(new RawFrameRecorder(path, RECORDING_BUFFER_FRAMES));
+    }
+    
+    void stopRecording()
+    {
+        mRecorder.reset();
+    }
+    
+    bool isRecording() const { return (bool)mRecorder; }
+    
+    // frames the recording lost to a slow disk, any of them makes it a failed recording
+    unsigned long getNumRecordingDropped() const { return mRecorder ? mRecorder->getNumDropped() : 0; }
+    bool isRecordingFailed() const { return mRecorder && mRecorder->isFailed(); }
+    
     ofParameterGroup& getParameterGroup()
     {
         return mParamGroup;
@@ -195,8 +665,8 @@ public:
     
     void drawCropRect(int x, int y, int w, int h)
     {
-        const float baseWidth  = mResizedPix.getWidth();
-        const float baseHeight = mResizedPix.getHeight();
+        const float baseWidth  = mFrames.getFront().resizedWidth;
+        const float baseHeight = mFrames.getFront().resizedHeight;
         
         ofPushMatrix();
         ofPushStyle();
@@ -220,9 +690,28 @@ class InputVideoController : public InputImageController<ofVideoPlayer>
 {
     typedef ofVideoPlayer basePlayer;
     const string mVideoPath;
+    const bool bGray;
+    
+public:
+    // bGray: ask the decoder for luma only (OF_PIXELS_MONO), RGB when the player can not
+    InputVideoController(const string& videoPath, bool bGray = true);
+    void setup();
+    void update();
+    void play();
+    void stop();
+    void togglePlay();
+};
+
+
+/// plays a raw frame file (rehearsal recording), see RawFramePlayer
+class InputFileController : public InputImageController<RawFramePlayer>
+{
+    typedef RawFramePlayer basePlayer;
+    const string mPath;
+    const float mFps;
     
 public:
-    InputVideoController(const string& videoPath);
+    InputFileController(const string& path, float fps);
     void setup();
     void update();
     void play();
@@ -237,9 +726,15 @@ class InputCameraController : public InputImageController<ofVideoGrabber>
     const int mWidth;
     const int mHeight;
     const int mDeviceId;
+    const bool bGray;
+    const string mFakeDevicePath;
     
 public:
-    InputCameraController(int w, int h, int deviceId);
+    /**
+     *  bGray: capture the luma plane only (OF_PIXELS_MONO), RGB when the device can not.
+     *  fakeDevicePath: play this raw frame file instead of opening a camera (FileVideoGrabber).
+     */
+    InputCameraController(int w, int h, int deviceId, bool bGray = true, const string& fakeDevicePath = "");
     void setup();
     void update();
     void play();
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ofMain.h"
+#include "utils.h"
+#include "BinaryMask.hpp"
+#include <functional>
+
+/**
+ *  One pass over the binary mask, after the threshold and before the contours.
+ *  Stages work on a band of rows so the incremental update can redo only the
+ *  rows around a change; getReach() tells how far (in rows) one changed pixel
+ *  can spread through the stage.
+ */
+class MaskStage
+{
+public:
+    virtual ~MaskStage() {}
+
+    /// true when process() would leave the mask as it is, the stage is skipped then
+    virtual bool isIdentity() const = 0;
+    virtual int getReach() const = 0;
+    virtual void process(BinaryMask& mask, int rowBegin, int rowEnd) = 0;
+};
+
+
+/// open, close, erode or dilate with a 3x3 square, iterations read from a setting of the worker
+class MorphologyStage : public MaskStage
+{
+public:
+    enum Op { OPEN, CLOSE, ERODE, DILATE };
+
+private:
+    const Op        mOp;
+    const int&      mIterations;    // owned by the thread that runs the stage, not a GUI parameter
+
+public:
+    MorphologyStage(Op op, const int& iterations) : mOp(op), mIterations(iterations) {}
+
+    bool isIdentity() const { return mIterations <= 0; }
+
+    int getReach() const
+    {
+        return (mOp == OPEN || mOp == CLOSE ? 2 : 1) * MAX(mIterations, 0);
+    }
+
+    void process(BinaryMask& mask, int rowBegin, int rowEnd)
+    {
+        switch (mOp)
+        {
+            case OPEN:   mask.open(mIterations, rowBegin, rowEnd);   break;
+            case CLOSE:  mask.close(mIterations, rowBegin, rowEnd);  break;
+            case ERODE:  mask.erode(mIterations, rowBegin, rowEnd);  break;
+            case DILATE: mask.dilate(mIterations, rowBegin, rowEnd); break;
+        }
+    }
+};
+
+
+/**
+ *  Ordered list of mask stages, built from a comma separated list of names
+ *  ("open,close"). Names are looked up in a registry of factories, so a rig
+ *  can drop, reorder or repeat stages from its settings XML, and new stages
+ *  are added with registerStage() instead of editing the controller.
+ */
+class MaskStageGraph
+{
+public:
+    typedef std::function<MaskStage*()> Factory;
+
+private:
+    map<string, Factory>        mFactories;
+    vector<ofPtr<MaskStage> >   mStages;
+
+public:
+    void registerStage(const string& name, const Factory& factory)
+    {
+        mFactories[name] = factory;
+    }
+
+    /// returns false if a name is unknown, the known stages are kept
+    bool build(const string& list)
+    {
+        bool bOk = true;
+        mStages.clear();
+        for (auto name : ofSplitString(list, ",", true, true))
+        {
+            name = ofToLower(name);
+            auto it = mFactories.find(name);
+            if (it == mFactories.end())
+            {
+                LOG_WARNING << "unknown mask stage: " << name;
+                bOk = false;
+                continue;
+            }
+            mStages.push_back(ofPtr<MaskStage>(it->second()));
+        }
+        return bOk;
+    }
+
+    /// no stage would change the mask
+    bool isIdentity() const
+    {
+        for (const auto& e : mStages) if (e->isIdentity() == false) return false;
+        return true;
+    }
+
+    /// rows one changed pixel can spread through all the stages
+    int getReach() const
+    {
+        int reach = 0;
+        for (const auto& e : mStages) if (e->isIdentity() == false) reach += e->getReach();
+        return reach;
+    }
+
+    void process(BinaryMask& mask, int rowBegin, int rowEnd)
+    {
+        for (const auto& e : mStages)
+        {
+            if (e->isIdentity() == false) e->process(mask, rowBegin, rowEnd);
+        }
+    }
+
+    int size() const { return mStages.size(); }
+};
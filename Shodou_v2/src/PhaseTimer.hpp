@@ -0,0 +1,262 @@
+#pragma once
+
+#include "ofMain.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <stdint.h>
+
+/**
+ *  Log-linear histogram of durations in nanoseconds, 8 buckets per power of
+ *  two (12.5% resolution) from 256ns to about a minute. Counts live in a few
+ *  one-second windows of atomics: record() is wait-free from any thread, and
+ *  rotate() (once a second, from one thread) recycles the oldest window, so
+ *  the percentiles always cover the last few seconds.
+ */
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS    = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MIN_OCTAVE  = 8;           // 256ns, shorter durations go into the first bucket
+    static const int NUM_OCTAVES = 28;
+    static const int NUM_BUCKETS = SUB_BUCKETS * NUM_OCTAVES;
+    static const int NUM_WINDOWS = 4;
+
+private:
+    struct Window
+    {
+        std::atomic<uint32_t>   counts[NUM_BUCKETS];
+        std::atomic<uint64_t>   maxNs;
+        std::atomic<uint64_t>   sumNs;
+    };
+
+    Window              mWindows[NUM_WINDOWS];
+    std::atomic<int>    mCurrent;
+
+    static int bucketOf(uint64_t ns)
+    {
+        if (ns < ((uint64_t)1 << MIN_OCTAVE)) return 0;
+        const int octave = 63 - __builtin_clzll(ns);
+        const int sub = (ns >> (octave - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return MIN((octave - MIN_OCTAVE) * SUB_BUCKETS + sub, NUM_BUCKETS - 1);
+    }
+
+    // middle of a bucket
+    static double bucketValue(int i)
+    {
+        const int octave = i / SUB_BUCKETS + MIN_OCTAVE;
+        const double width = (double)((uint64_t)1 << (octave - SUB_BITS));
+        return ((uint64_t)1 << octave) + (i % SUB_BUCKETS + 0.5) * width;
+    }
+
+    static void clear(Window& w)
+    {
+        for (int i = 0; i < NUM_BUCKETS; ++i) w.counts[i].store(0, std::memory_order_relaxed);
+        w.maxNs.store(0, std::memory_order_relaxed);
+        w.sumNs.store(0, std::memory_order_relaxed);
+    }
+
+public:
+    LatencyHistogram() : mCurrent(0)
+    {
+        for (int i = 0; i < NUM_WINDOWS; ++i) clear(mWindows[i]);
+    }
+
+    void record(uint64_t ns)
+    {
+        Window& w = mWindows[mCurrent.load(std::memory_order_relaxed)];
+        w.counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        w.sumNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = w.maxNs.load(std::memory_order_relaxed);
+        while (ns > m && w.maxNs.compare_exchange_weak(m, ns, std::memory_order_relaxed) == false) {}
+    }
+
+    /// start a new window, dropping the oldest one
+    void rotate()
+    {
+        const int next = (mCurrent.load(std::memory_order_relaxed) + 1) % NUM_WINDOWS;
+        clear(mWindows[next]);
+        mCurrent.store(next, std::memory_order_relaxed);
+    }
+
+    /// forget everything, not safe against concurrent record()
+    void reset()
+    {
+        for (int i = 0; i < NUM_WINDOWS; ++i) clear(mWindows[i]);
+    }
+
+    struct Summary
+    {
+        uint64_t    count;
+        uint64_t    totalNs;
+        double      p50, p95, p99, max;     // milliseconds
+    };
+
+    Summary getSummary() const
+    {
+        uint32_t counts[NUM_BUCKETS] = {};
+        Summary s = { 0, 0, 0, 0, 0, 0 };
+        uint64_t maxNs = 0;
+        for (const auto& w : mWindows)
+        {
+            for (int i = 0; i < NUM_BUCKETS; ++i) counts[i] += w.counts[i].load(std::memory_order_relaxed);
+            maxNs = MAX(maxNs, w.maxNs.load(std::memory_order_relaxed));
+            s.totalNs += w.sumNs.load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < NUM_BUCKETS; ++i) s.count += counts[i];
+        if (s.count == 0) return s;
+
+        const double ranks[3] = { 0.50, 0.95, 0.99 };
+        double* values[3] = { &s.p50, &s.p95, &s.p99 };
+        uint64_t seen = 0;
+        int r = 0;
+        for (int i = 0; i < NUM_BUCKETS && r < 3; ++i)
+        {
+            seen += counts[i];
+            while (r < 3 && seen >= ranks[r] * s.count)
+            {
+                *values[r++] = MIN(bucketValue(i), (double)maxNs) * 1e-6;
+            }
+        }
+        s.max = maxNs * 1e-6;
+        return s;
+    }
+};
+
+
+/**
+ *  Named phases of a frame, each with its own histogram.
+ *
+ *      { PhaseTimer::Scope t(PhaseTimer::GUI); gui.draw(); }
+ *
+ *      PhaseTimer::Lap lap;        // consecutive stages
+ *      stageA(); lap.next(PhaseTimer::STAGE_A);
+ *      stageB(); lap.next(PhaseTimer::STAGE_B);
+ */
+namespace PhaseTimer
+{
+    enum Phase
+    {
+        FRAME,              // main loop, update to update
+        QUEUE,              // capture until the worker starts on the frame
+        VISION,             // one captured frame through the worker
+        GRAY,
+        REMAP,
+        CHANGE,
+        PREVIEW,
+        THRESHOLD,
+        MASK_STAGES,
+        CONTOURS,
+        PUBLISH,
+        BLOBS,
+        BLOB_UPDATE,
+        VISUAL_UPDATE,
+        VISUAL_RENDER,
+        GUI,
+        LATENCY,            // capture until the blobs of the frame are built
+        NUM_PHASES
+    };
+
+    inline const char* getName(Phase p)
+    {
+        static const char* names[NUM_PHASES] =
+        {
+            "frame", "queue wait", "vision", "gray", "remap", "change", "preview", "threshold", "mask stages",
+            "contours", "publish", "blobs", "blob update", "visual update", "visual render", "gui", "latency"
+        };
+        return names[p];
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    inline LatencyHistogram& getHistogram(Phase p)
+    {
+        static LatencyHistogram histograms[NUM_PHASES];
+        return histograms[p];
+    }
+
+    inline void record(Phase p, Clock::duration d)
+    {
+        getHistogram(p).record(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+    class Scope
+    {
+        const Phase             mPhase;
+        const Clock::time_point mBegin;
+    public:
+        explicit Scope(Phase p) : mPhase(p), mBegin(Clock::now()) {}
+        ~Scope() { record(mPhase, Clock::now() - mBegin); }
+    };
+
+    class Lap
+    {
+        Clock::time_point mMark;
+    public:
+        Lap() : mMark(Clock::now()) {}
+
+        /// time since the last mark goes to p
+        void next(Phase p)
+        {
+            const Clock::time_point now = Clock::now();
+            record(p, now - mMark);
+            mMark = now;
+        }
+    };
+
+    /// "phase  p50  p95  p99  max" lines in milliseconds, for the phases that were recorded
+    inline string getReport()
+    {
+        stringstream s;
+        s << "phase [ms]       p50    p95    p99    max" << endl;
+        for (int i = 0; i < NUM_PHASES; ++i)
+        {
+            const LatencyHistogram::Summary e = getHistogram((Phase)i).getSummary();
+            if (e.count == 0) continue;
+            char line[128];
+            snprintf(line, sizeof(line), "%-14s %6.2f %6.2f %6.2f %6.2f",
+                     getName((Phase)i), e.p50, e.p95, e.p99, e.max);
+            s << line << endl;
+        }
+        return s.str();
+    }
+
+    /**
+     *  Call once per frame from one thread. Every second the histograms move
+     *  to a new window and, when csvPath is not empty, one row per phase
+     *  (time, phase, count, p50, p95, p99, max) is appended to the file.
+     */
+    inline void update(const string& csvPath)
+    {
+        static Clock::time_point last = Clock::now();
+        const Clock::time_point now = Clock::now();
+        if (now - last < std::chrono::seconds(1)) return;
+        last = now;
+
+        if (csvPath.empty() == false)
+        {
+            static std::ofstream csv;
+            static string openPath;
+            if (openPath != csvPath)
+            {
+                // an appending stream reports position 0 until it writes, so the size is read before
+                const bool bNewFile = std::ifstream(csvPath.c_str(), std::ios::ate).tellg() <= 0;
+                csv.close();
+                csv.open(csvPath.c_str(), std::ios::app);
+                openPath = csvPath;
+                if (bNewFile) csv << "time,phase,count,p50_ms,p95_ms,p99_ms,max_ms" << endl;
+            }
+            const double t = ofGetElapsedTimef();
+            for (int i = 0; i < NUM_PHASES; ++i)
+            {
+                const LatencyHistogram::Summary e = getHistogram((Phase)i).getSummary();
+                if (e.count == 0) continue;
+                csv << t << "," << getName((Phase)i) << "," << e.count << ","
+                    << e.p50 << "," << e.p95 << "," << e.p99 << "," << e.max << endl;
+            }
+        }
+
+        for (int i = 0; i < NUM_PHASES; ++i) getHistogram((Phase)i).rotate();
+    }
+}
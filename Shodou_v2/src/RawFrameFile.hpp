@@ -0,0 +1,385 @@
+#pragma once
+
+#include "ofMain.h"
+#include "utils.h"
+#include "ImageProcessing.hpp"
+#include <stdint.h>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ *  Raw frame container: this header, padded to FRAME_OFFSET bytes, then the
+ *  frames back to back (width * height * channels bytes each, GRAY8 or RGB24).
+ *  The number of frames follows from the file size, so a recording that was
+ *  cut off is still readable up to its last complete frame.
+ */
+struct RawFrameHeader
+{
+    static const uint32_t VERSION      = 1;
+    static const uint32_t FRAME_OFFSET = 4096;     // the first frame starts page aligned
+
+    char        magic[8];       // "SHODOUFR"
+    uint32_t    version;
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    channels;
+    float       fps;            // rate of the recording
+
+    RawFrameHeader() : version(VERSION), width(0), height(0), channels(0), fps(0)
+    {
+        memcpy(magic, "SHODOUFR", sizeof(magic));
+    }
+
+    bool isValid() const
+    {
+        return memcmp(magic, "SHODOUFR", sizeof(magic)) == 0 && version == VERSION
+            && width > 0 && height > 0 && (channels == 1 || channels == 3);
+    }
+
+    size_t getFrameSize() const { return (size_t)width * height * channels; }
+};
+
+
+/**
+ *  Plays a raw frame file like ofVideoPlayer, without decoding: the file is
+ *  memory mapped and getPixelsRef() is a view into the mapping (read only,
+ *  the pipeline never writes its source). Frames advance at the recorded or
+ *  a fixed rate, or one per update() when free running (rate 0), which makes
+ *  a run reproducible frame by frame.
+ */
+class RawFramePlayer
+{
+    RawFrameHeader      mHeader;
+    unsigned char*      mData;
+    size_t              mMappedSize;
+    int                 mNumFrames;
+    ofPixels            mFrame;
+
+    int                 mCurrent;
+    int                 mStartFrame;
+    float               mStartTime;
+    float               mFps;
+    bool                bPlaying;
+    bool                bLoop;
+    bool                bFrameNew;
+
+    void showFrame(int i)
+    {
+        mCurrent = i;
+        unsigned char* px = mData + RawFrameHeader::FRAME_OFFSET + mHeader.getFrameSize() * i;
+        mFrame.setFromExternalPixels(px, mHeader.width, mHeader.height, mHeader.channels);
+        bFrameNew = true;
+    }
+
+public:
+    RawFramePlayer()
+    : mData(NULL), mMappedSize(0), mNumFrames(0), mCurrent(-1), mStartFrame(0), mStartTime(0), mFps(-1)
+    , bPlaying(false), bLoop(true), bFrameNew(false)
+    {}
+
+    virtual ~RawFramePlayer() { close(); }
+
+    bool load(const string& path)
+    {
+        close();
+        const string fullPath = ofToDataPath(path);
+        const int fd = ::open(fullPath.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            LOG_ERROR << "failed to open frame file: " << fullPath;
+            return false;
+        }
+        struct stat st;
+        const bool bHeader = fstat(fd, &st) == 0 && st.st_size >= RawFrameHeader::FRAME_OFFSET
+            && ::read(fd, &mHeader, sizeof(mHeader)) == sizeof(mHeader) && mHeader.isValid();
+        if (bHeader == false)
+        {
+            LOG_ERROR << "not a frame file: " << fullPath;
+            ::close(fd);
+            return false;
+        }
+        mNumFrames = (st.st_size - RawFrameHeader::FRAME_OFFSET) / mHeader.getFrameSize();
+        void* p = mNumFrames > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            LOG_ERROR << "failed to map frame file: " << fullPath;
+            mNumFrames = 0;
+            return false;
+        }
+        mData = (unsigned char*)p;
+        mMappedSize = st.st_size;
+        madvise(mData, mMappedSize, MADV_SEQUENTIAL);
+        showFrame(0);
+        return true;
+    }
+
+    void close()
+    {
+        if (mData) munmap(mData, mMappedSize);
+        mData = NULL;
+        mMappedSize = 0;
+        mNumFrames = 0;
+        mCurrent = -1;
+        mFrame.clear();
+        bPlaying = false;
+        bFrameNew = false;
+    }
+
+    /// frames per second, 0 for one frame per update(), negative for the rate of the recording
+    void setFrameRate(float fps) { mFps = fps; mStartFrame = MAX(mCurrent, 0); mStartTime = ofGetElapsedTimef(); }
+    void setLoop(bool b)        { bLoop = b; }
+
+    void play()
+    {
+        if (isLoaded() == false || bPlaying) return;
+        bPlaying = true;
+        setFrameRate(mFps);
+    }
+
+    void stop() { bPlaying = false; }
+
+    void setFrame(int i)
+    {
+        if (isLoaded() == false) return;
+        showFrame(ofClamp(i, 0, mNumFrames - 1));
+        setFrameRate(mFps);
+    }
+
+    void update()
+    {
+        bFrameNew = false;
+        if (bPlaying == false) return;
+
+        const float fps = mFps < 0 ? mHeader.fps : mFps;
+        int next = mCurrent + 1;
+        if (fps > 0)
+        {
+            next = mStartFrame + (int)((ofGetElapsedTimef() - mStartTime) * fps);
+            if (next == mCurrent) return;
+        }
+        if (next >= mNumFrames)
+        {
+            if (bLoop == false)
+            {
+                bPlaying = false;
+                return;
+            }
+            next %= mNumFrames;
+            if (fps > 0 && next < mCurrent)
+            {
+                // keep the clock small so the frame index stays exact over long loops
+                mStartFrame = next;
+                mStartTime = ofGetElapsedTimef();
+            }
+        }
+        showFrame(next);
+    }
+
+    bool isLoaded() const       { return mData != NULL; }
+    bool isPlaying() const      { return bPlaying; }
+    bool isFrameNew() const     { return bFrameNew; }
+    int getCurrentFrame() const { return mCurrent; }
+    int getTotalNumFrames() const { return mNumFrames; }
+    float getWidth() const      { return mHeader.width; }
+    float getHeight() const     { return mHeader.height; }
+    const RawFrameHeader& getHeader() const { return mHeader; }
+
+    ofPixels& getPixelsRef()    { return mFrame; }
+};
+
+
+/**
+ *  Appends frames to a raw frame file, for rehearsal recordings.
+ *  With a rate of 0 the rate is measured from the frame times and stored
+ *  in the header on close().
+ */
+class RawFrameWriter
+{
+    FILE*           mFile;
+    RawFrameHeader  mHeader;
+    int             mNumFrames;
+    float           mFirstTime, mLastTime;
+
+public:
+    RawFrameWriter() : mFile(NULL), mNumFrames(0), mFirstTime(0), mLastTime(0) {}
+    ~RawFrameWriter() { close(); }
+
+    bool open(const string& path, int w, int h, int channels, float fps = 0)
+    {
+        close();
+        mHeader = RawFrameHeader();
+        mHeader.width = w;
+        mHeader.height = h;
+        mHeader.channels = channels;
+        mHeader.fps = fps;
+        if (mHeader.isValid() == false)
+        {
+            LOG_ERROR << "unsupported frame format " << w << "x" << h << "x" << channels;
+            return false;
+        }
+        mFile = fopen(ofToDataPath(path).c_str(), "wb");
+        if (mFile == NULL)
+        {
+            LOG_ERROR << "failed to create frame file: " << path;
+            return false;
+        }
+        vector<char> header(RawFrameHeader::FRAME_OFFSET, 0);
+        memcpy(header.data(), &mHeader, sizeof(mHeader));
+        fwrite(header.data(), 1, header.size(), mFile);
+        mNumFrames = 0;
+        return true;
+    }
+
+    /// frames of another size or format are dropped, time (seconds) is when the frame was taken
+    bool write(const ofPixels& pix, float time)
+    {
+        if (mFile == NULL || pix.getWidth() != (int)mHeader.width || pix.getHeight() != (int)mHeader.height
+            || pix.getNumChannels() != (int)mHeader.channels)
+        {
+            return false;
+        }
+        const size_t size = mHeader.getFrameSize();
+        if (fwrite(pix.getPixels(), 1, size, mFile) != size) return false;
+        mLastTime = time;
+        if (mNumFrames++ == 0) mFirstTime = mLastTime;
+        return true;
+    }
+
+    void close()
+    {
+        if (mFile == NULL) return;
+        if (mHeader.fps <= 0 && mNumFrames > 1 && mLastTime > mFirstTime)
+        {
+            mHeader.fps = (mNumFrames - 1) / (mLastTime - mFirstTime);
+            fseek(mFile, 0, SEEK_SET);
+            fwrite(&mHeader, 1, sizeof(mHeader), mFile);
+        }
+        fclose(mFile);
+        mFile = NULL;
+    }
+
+    bool isOpen() const         { return mFile != NULL; }
+    int getNumFrames() const    { return mNumFrames; }
+};
+
+
+/**
+ *  Records to a raw frame file on a writer thread, so the capture thread only
+ *  copies the frame: the file is created with the size of the first frame and
+ *  the frames wait in a bounded FIFO until they are written, in order.
+ *  A recording is meant to be rerun as an exact input, so it must not have
+ *  gaps: when the disk falls so far behind that the FIFO is full, the
+ *  recording fails. The frames before are still written (the file ends there)
+ *  and every later frame is counted as dropped.
+ */
+class RawFrameRecorder
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Slot
+    {
+        ofPixels            pixels;
+        Clock::time_point   captureTime;
+    };
+
+    RawFrameWriter          mWriter;
+    string                  mPath;
+    vector<Slot>            mSlots;         // ring, the frames are allocated on first use
+    int                     mHead, mCount;
+    bool                    bClosed;
+    std::atomic<bool>       bFailed;
+    std::atomic<unsigned long> mNumDropped;
+    std::mutex              mMutex;
+    std::condition_variable mCond;
+    std::thread             mThread;
+
+    void writeLoop()
+    {
+        Clock::time_point start;
+        for (;;)
+        {
+            int slot;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCond.wait(lock, [&]{ return bClosed || mCount > 0; });
+                if (mCount == 0) return;
+                slot = mHead;
+            }
+            // the capture thread leaves a queued slot alone, it is written without the lock
+            const Slot& e = mSlots[slot];
+            if (mWriter.isOpen() == false)
+            {
+                start = e.captureTime;
+                if (mWriter.open(mPath, e.pixels.getWidth(), e.pixels.getHeight(), e.pixels.getNumChannels()) == false)
+                {
+                    bFailed = true;
+                }
+            }
+            if (mWriter.isOpen()) mWriter.write(e.pixels, std::chrono::duration<float>(e.captureTime - start).count());
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mHead = (mHead + 1) % mSlots.size();
+            mCount--;
+        }
+    }
+
+public:
+    /// capacity: frames the writer may fall behind before the recording fails
+    RawFrameRecorder(const string& path, int capacity)
+    : mPath(path), mSlots(MAX(capacity, 1)), mHead(0), mCount(0), bClosed(false), bFailed(false), mNumDropped(0)
+    {
+        mThread = std::thread(&RawFrameRecorder::writeLoop, this);
+    }
+
+    /// writes the frames still waiting, then closes the file
+    ~RawFrameRecorder()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            bClosed = true;
+            mCond.notify_all();
+        }
+        mThread.join();
+        mWriter.close();
+        if (bFailed)
+        {
+            LOG_ERROR << "recording failed, " << mNumDropped << " frames dropped: " << mPath
+                      << " holds only the " << mWriter.getNumFrames() << " frames before";
+        }
+    }
+
+    /// capture thread: copies the frame for the writer
+    void submit(const ofPixels& pix, Clock::time_point captureTime = Clock::now())
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (bFailed == false && mCount == (int)mSlots.size())
+        {
+            LOG_ERROR << "recording can not keep up, the frames after the last " << mSlots.size()
+                      << " queued are dropped: " << mPath;
+            bFailed = true;
+        }
+        if (bFailed)
+        {
+            mNumDropped++;
+            return;
+        }
+        Slot& slot = mSlots[(mHead + mCount) % mSlots.size()];
+        imp::copyPixels(pix, slot.pixels);
+        slot.captureTime = captureTime;
+        mCount++;
+        mCond.notify_one();
+    }
+
+    /// true once a frame was dropped (or the file could not be created), the recording is cut there
+    bool isFailed() const               { return bFailed; }
+    unsigned long getNumDropped() const { return mNumDropped; }
+};
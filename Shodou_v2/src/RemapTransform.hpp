@@ -0,0 +1,277 @@
+#pragma once
+
+#include "ofMain.h"
+#include "utils.h"
+#include "ImageProcessing.hpp"
+
+/**
+ *  flip -> resize -> crop -> warpPerspective composed into one inverse mapping.
+ *  For every output pixel the lookup table holds the top-left source tap and
+ *  Q8 bilinear weights into the full resolution gray frame, so the whole
+ *  geometric chain is a single resampling pass. Rebuild it with setup() when
+ *  one of the geometric parameters changes.
+ *  Up to a ratio of 2 the taps cover every source pixel (at 2 they sit between
+ *  four pixels, a 2x2 box). Above it the two taps would skip pixels and thin
+ *  strokes alias, so the rows in use are first box averaged ratio x ratio and
+ *  the table points into that downscaled frame instead.
+ */
+class RemapTransform
+{
+public:
+    struct Entry
+    {
+        int             offset;     // index of the top-left tap, -1 when outside the crop
+        unsigned short  fx, fy;     // 0..256
+    };
+
+    // value written where the warped crop has no source pixel (blank paper)
+    static const unsigned char FILL_VALUE = 255;
+
+private:
+    vector<Entry>   mLut;
+    int             mSrcWidth, mSrcHeight;
+    int             mBox;           // box prefilter size, 1 without prefilter
+    int             mBoxRowBegin, mBoxRowEnd;
+    vector<unsigned char>   mBoxPix;    // mResizedWidth x mResizedHeight, rows in use only
+    vector<unsigned short>  mBoxSum;    // column sums of one box row
+    int             mWidth, mHeight;
+    int             mResizedWidth, mResizedHeight;
+    int             mRowBegin, mRowEnd;
+    bool            bIdentity;      // output == source, no table is built
+
+    // square (0,0)-(1,1) to quad p[0..3] homography
+    static void squareToQuad(const ofPoint* p, double* m)
+    {
+        const double sx = p[0].x - p[1].x + p[2].x - p[3].x;
+        const double sy = p[0].y - p[1].y + p[2].y - p[3].y;
+        double g = 0, h = 0;
+        if (fabs(sx) > 1e-9 || fabs(sy) > 1e-9)
+        {
+            const double dx1 = p[1].x - p[2].x, dx2 = p[3].x - p[2].x;
+            const double dy1 = p[1].y - p[2].y, dy2 = p[3].y - p[2].y;
+            const double del = dx1 * dy2 - dx2 * dy1;
+            g = (sx * dy2 - dx2 * sy) / del;
+            h = (dx1 * sy - sx * dy1) / del;
+        }
+        m[0] = p[1].x - p[0].x + g * p[1].x;
+        m[1] = p[3].x - p[0].x + h * p[3].x;
+        m[2] = p[0].x;
+        m[3] = p[1].y - p[0].y + g * p[1].y;
+        m[4] = p[3].y - p[0].y + h * p[3].y;
+        m[5] = p[0].y;
+        m[6] = g;
+        m[7] = h;
+    }
+
+public:
+    RemapTransform()
+    : mSrcWidth(0), mSrcHeight(0), mBox(1), mBoxRowBegin(0), mBoxRowEnd(0), mWidth(0), mHeight(0)
+    , mResizedWidth(0), mResizedHeight(0), mRowBegin(0), mRowEnd(0), bIdentity(false)
+    {}
+
+    void setup(int srcWidth, int srcHeight, bool flipH, bool flipV, int ratio,
+               const ofVec2f& cropXY1, const ofVec2f& cropXY2, float warpX, float warpY)
+    {
+        ratio = MAX(ratio, 1);
+        mSrcWidth  = srcWidth;
+        mSrcHeight = srcHeight;
+        mResizedWidth  = srcWidth  / ratio;
+        mResizedHeight = srcHeight / ratio;
+        mBox = ratio > 2 && mResizedWidth >= 2 && mResizedHeight >= 2 ? ratio : 1;
+        bIdentity = false;
+        if (mSrcWidth < 2 || mSrcHeight < 2 || mResizedWidth == 0 || mResizedHeight == 0)
+        {
+            mLut.clear();
+            mWidth = mHeight = 0;
+            return;
+        }
+
+        int x1, y1, x2, y2;
+        imp::getCropRect(mResizedWidth, mResizedHeight, cropXY1, cropXY2, x1, y1, x2, y2);
+        mWidth  = x2 - x1;
+        mHeight = y2 - y1;
+
+        // nothing to resample: apply() only copies and limits the frame
+        if (ratio == 1 && flipH == false && flipV == false && warpX == 0 && warpY == 0
+            && mWidth == mSrcWidth && mHeight == mSrcHeight)
+        {
+            vector<Entry>().swap(mLut);
+            bIdentity = true;
+            mRowBegin = 0;
+            mRowEnd   = mSrcHeight;
+            return;
+        }
+
+        // the quad of the cropped image that is stretched to the output rect
+        const double w = mWidth;
+        const double h = mHeight;
+        ofPoint quad[4];
+        quad[0] = ofPoint( (warpX > 0 ? 0.0 : -warpX    ), (warpY > 0 ? 0.0   : -warpY ) );
+        quad[1] = ofPoint( (warpX > 0 ? w   : w + warpX ), (warpY > 0 ? warpY : 0.0    ) );
+        quad[2] = ofPoint( (warpX > 0 ? w - warpX : w   ), (warpY > 0 ? h - warpY : h  ) );
+        quad[3] = ofPoint( (warpX > 0 ? warpX : 0.0     ), (warpY > 0 ? h     : h + warpY) );
+        double m[8];
+        squareToQuad(quad, m);
+
+        // center of a downscaled pixel in full resolution coordinates
+        const double center = (ratio - 1) * 0.5;
+        // the frame the taps read: the source, or the box averaged frame
+        const int tapWidth  = mBox > 1 ? mResizedWidth  : mSrcWidth;
+        const int tapHeight = mBox > 1 ? mResizedHeight : mSrcHeight;
+
+        mLut.resize(mWidth * mHeight);
+        mRowBegin = mSrcHeight;
+        mRowEnd   = 0;
+        Entry* e = &mLut[0];
+        for (int v = 0; v < mHeight; ++v)
+        {
+            for (int u = 0; u < mWidth; ++u, ++e)
+            {
+                const double su = u / w;
+                const double sv = v / h;
+                const double z  = m[6] * su + m[7] * sv + 1.0;
+                const double cx = (m[0] * su + m[1] * sv + m[2]) / z;
+                const double cy = (m[3] * su + m[4] * sv + m[5]) / z;
+                if (cx < -0.5 || cy < -0.5 || cx > w - 0.5 || cy > h - 0.5)
+                {
+                    e->offset = -1;
+                    e->fx = e->fy = 0;
+                    continue;
+                }
+
+                double sx = mBox > 1 ? cx + x1 : (cx + x1) * ratio + center;
+                double sy = mBox > 1 ? cy + y1 : (cy + y1) * ratio + center;
+                if (flipH) sx = tapWidth  - 1 - sx;
+                if (flipV) sy = tapHeight - 1 - sy;
+                sx = ofClamp(sx, 0, tapWidth  - 1);
+                sy = ofClamp(sy, 0, tapHeight - 1);
+
+                const int ix = MIN((int)sx, tapWidth  - 2);
+                const int iy = MIN((int)sy, tapHeight - 2);
+                e->offset = iy * tapWidth + ix;
+                e->fx = (sx - ix) * 256 + 0.5;
+                e->fy = (sy - iy) * 256 + 0.5;
+                mRowBegin = MIN(mRowBegin, iy);
+                mRowEnd   = MAX(mRowEnd, iy + 2);
+            }
+        }
+        if (mRowEnd < mRowBegin) mRowBegin = mRowEnd = 0;
+        if (mBox > 1)
+        {
+            // rows of the box frame, and the source rows they average
+            mBoxRowBegin = mRowBegin;
+            mBoxRowEnd   = mRowEnd;
+            mRowBegin    = mBoxRowBegin * mBox;
+            mRowEnd      = mBoxRowEnd * mBox;
+            mBoxPix.resize(mResizedWidth * mResizedHeight);
+            mBoxSum.resize(mResizedWidth * mBox);
+        }
+        else
+        {
+            vector<unsigned char>().swap(mBoxPix);
+            vector<unsigned short>().swap(mBoxSum);
+        }
+    }
+
+    // mBoxPix rows mBoxRowBegin..mBoxRowEnd = mBox x mBox averages of the gray frame
+    void boxFilter(const unsigned char* gray)
+    {
+        const int n = mBox * mBox;
+        // v / n as a multiply, exact for the sums of up to 16 x 16 pixels
+        const uint64_t inv = ((1ULL << 32) + n - 1) / n;
+        const int w = mResizedWidth * mBox;
+        for (int by = mBoxRowBegin; by < mBoxRowEnd; ++by)
+        {
+            unsigned short* sum = &mBoxSum[0];
+            // columns first, a plain loop over the row the compiler vectorizes
+            const unsigned char* p = gray + by * mBox * mSrcWidth;
+            for (int x = 0; x < w; ++x) sum[x] = p[x];
+            for (int ky = 1; ky < mBox; ++ky)
+            {
+                p += mSrcWidth;
+                for (int x = 0; x < w; ++x) sum[x] += p[x];
+            }
+            unsigned char* out = &mBoxPix[by * mResizedWidth];
+            for (int bx = 0; bx < mResizedWidth; ++bx, sum += mBox)
+            {
+                unsigned int v = n / 2;
+                for (int kx = 0; kx < mBox; ++kx) v += sum[kx];
+                out[bx] = (v * inv) >> 32;
+            }
+        }
+    }
+
+    /**
+     *  resample the gray frame (srcWidth x srcHeight, only rows getRowBegin()..getRowEnd()
+     *  are read) into dst and apply the black limit on the way.
+     *  When integral is given, the (w + 1) x (h + 1) summed-area table of dst
+     *  (first row and column 0) is written in the same pass.
+     */
+    void apply(const unsigned char* gray, ofPixels& dst, int blackThreshold, unsigned int* integral = NULL)
+    {
+        if (isAllocated() == false) return;
+        imp::allocateIfNeeded(dst, mWidth, mHeight, 1);
+        if (mBox > 1)
+        {
+            boxFilter(gray);
+            gray = &mBoxPix[0];
+        }
+
+        const int stride = mBox > 1 ? mResizedWidth : mSrcWidth;
+        const int iw = mWidth + 1;
+        const Entry* e = bIdentity ? NULL : &mLut[0];
+        unsigned char* out = dst.getPixels();
+        if (integral) memset(integral, 0, iw * sizeof(unsigned int));
+        for (int y = 0; y < mHeight; ++y)
+        {
+            unsigned int rowSum = 0;
+            if (integral) integral[(y + 1) * iw] = 0;
+            if (bIdentity)
+            {
+                const unsigned char* src = gray + y * stride;
+                for (int x = 0; x < mWidth; ++x, ++out)
+                {
+                    const unsigned int v = src[x] >= blackThreshold ? 255 : src[x];
+                    *out = v;
+                    if (integral)
+                    {
+                        rowSum += v;
+                        integral[(y + 1) * iw + x + 1] = integral[y * iw + x + 1] + rowSum;
+                    }
+                }
+                continue;
+            }
+            for (int x = 0; x < mWidth; ++x, ++e, ++out)
+            {
+                unsigned int v = FILL_VALUE;
+                if (e->offset >= 0)
+                {
+                    const unsigned char* p = gray + e->offset;
+                    const unsigned int fx = e->fx;
+                    const unsigned int fy = e->fy;
+                    const unsigned int top = p[0]      * (256 - fx) + p[1]          * fx;
+                    const unsigned int bot = p[stride] * (256 - fx) + p[stride + 1] * fx;
+                    v = (top * (256 - fy) + bot * fy + 32768) >> 16;
+                    if ((int)v >= blackThreshold) v = 255;
+                }
+                *out = v;
+                if (integral)
+                {
+                    rowSum += v;
+                    integral[(y + 1) * iw + x + 1] = integral[y * iw + x + 1] + rowSum;
+                }
+            }
+        }
+    }
+
+    bool isAllocated() const { return mWidth > 0 && mHeight > 0; }
+    bool isIdentity() const { return bIdentity; }
+    int getSrcWidth() const { return mSrcWidth; }
+    int getSrcHeight() const { return mSrcHeight; }
+    int getWidth() const { return mWidth; }
+    int getHeight() const { return mHeight; }
+    int getResizedWidth() const { return mResizedWidth; }
+    int getResizedHeight() const { return mResizedHeight; }
+    int getRowBegin() const { return mRowBegin; }
+    int getRowEnd() const { return mRowEnd; }
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "ofMain.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define RGB_TO_GRAY_X86
+#   include <cpuid.h>
+#   include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define RGB_TO_GRAY_NEON
+#   include <arm_neon.h>
+#endif
+
+/**
+ *  RGB24 -> GRAY8 row kernels.
+ *  All paths compute (r * GRAY_COEF_R + g * GRAY_COEF_G + b * GRAY_COEF_B + 2^13) >> 14
+ *  so they are bit-exact with scalarRow(). The best path for this CPU is picked on first use, by
+ *  cpuid only; `make test-gray` checks every path this CPU runs against scalarRow().
+ */
+namespace ImageProcessing
+{
+    // fixed-point (Q14) luma weights, same ratio as the former double coefficients
+    static const int GRAY_SHIFT  = 14;
+    static const int GRAY_COEF_R = 4897;    // 0.298912
+    static const int GRAY_COEF_G = 9611;    // 0.586611
+    static const int GRAY_COEF_B = 1876;    // 0.114478
+    static const int GRAY_ROUND  = 1 << (GRAY_SHIFT - 1);
+
+    namespace gray
+    {
+        typedef void (*RowFunc)(const unsigned char* rgb, unsigned char* dst, int n);
+
+        inline unsigned char toGray(const unsigned char* p)
+        {
+            return (p[0] * GRAY_COEF_R + p[1] * GRAY_COEF_G + p[2] * GRAY_COEF_B + GRAY_ROUND) >> GRAY_SHIFT;
+        }
+
+        // reference path
+        inline void scalarRow(const unsigned char* rgb, unsigned char* dst, int n)
+        {
+            for (int i = 0; i < n; ++i, rgb += 3)
+            {
+                dst[i] = toGray(rgb);
+            }
+        }
+
+#ifdef RGB_TO_GRAY_X86
+
+        // 4 pixels (12 bytes) of a 16 byte load -> (r, g) and (b, 1) 16-bit pairs for pmaddwd
+#       define RGB_TO_GRAY_RG_MASK  0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1
+#       define RGB_TO_GRAY_B_MASK   2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1
+
+        __attribute__((target("ssse3")))
+        inline void ssse3Row(const unsigned char* rgb, unsigned char* dst, int n)
+        {
+            const __m128i rgMask = _mm_setr_epi8(RGB_TO_GRAY_RG_MASK);
+            const __m128i bMask  = _mm_setr_epi8(RGB_TO_GRAY_B_MASK);
+            const __m128i one    = _mm_setr_epi16(0, 1, 0, 1, 0, 1, 0, 1);
+            const __m128i rgCoef = _mm_setr_epi16(GRAY_COEF_R, GRAY_COEF_G, GRAY_COEF_R, GRAY_COEF_G,
+                                                  GRAY_COEF_R, GRAY_COEF_G, GRAY_COEF_R, GRAY_COEF_G);
+            const __m128i bCoef  = _mm_setr_epi16(GRAY_COEF_B, GRAY_ROUND, GRAY_COEF_B, GRAY_ROUND,
+                                                  GRAY_COEF_B, GRAY_ROUND, GRAY_COEF_B, GRAY_ROUND);
+            int i = 0;
+            // the last 16 byte load of a block reads 4 bytes past it
+            for (; i + 18 <= n; i += 16, rgb += 48)
+            {
+                __m128i s[4];
+                for (int k = 0; k < 4; ++k)
+                {
+                    const __m128i v  = _mm_loadu_si128((const __m128i*)(rgb + k * 12));
+                    const __m128i rg = _mm_shuffle_epi8(v, rgMask);
+                    const __m128i b1 = _mm_or_si128(_mm_shuffle_epi8(v, bMask), one);
+                    s[k] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(rg, rgCoef),
+                                                        _mm_madd_epi16(b1, bCoef)), GRAY_SHIFT);
+                }
+                const __m128i lo = _mm_packs_epi32(s[0], s[1]);
+                const __m128i hi = _mm_packs_epi32(s[2], s[3]);
+                _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+            }
+            scalarRow(rgb, dst + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void avx2Row(const unsigned char* rgb, unsigned char* dst, int n)
+        {
+            const __m256i rgMask = _mm256_setr_epi8(RGB_TO_GRAY_RG_MASK, RGB_TO_GRAY_RG_MASK);
+            const __m256i bMask  = _mm256_setr_epi8(RGB_TO_GRAY_B_MASK, RGB_TO_GRAY_B_MASK);
+            const __m256i one    = _mm256_set1_epi32(1 << 16);
+            const __m256i rgCoef = _mm256_set1_epi32((GRAY_COEF_G << 16) | GRAY_COEF_R);
+            const __m256i bCoef  = _mm256_set1_epi32((GRAY_ROUND << 16) | GRAY_COEF_B);
+            // packs/packus work per 128-bit lane, this puts the 4-pixel groups back in order
+            const __m256i order  = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            int i = 0;
+            for (; i + 34 <= n; i += 32, rgb += 96)
+            {
+                __m256i s[4];
+                for (int k = 0; k < 4; ++k)
+                {
+                    const __m128i v0 = _mm_loadu_si128((const __m128i*)(rgb + k * 24));
+                    const __m128i v1 = _mm_loadu_si128((const __m128i*)(rgb + k * 24 + 12));
+                    const __m256i v  = _mm256_inserti128_si256(_mm256_castsi128_si256(v0), v1, 1);
+                    const __m256i rg = _mm256_shuffle_epi8(v, rgMask);
+                    const __m256i b1 = _mm256_or_si256(_mm256_shuffle_epi8(v, bMask), one);
+                    s[k] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(rg, rgCoef),
+                                                              _mm256_madd_epi16(b1, bCoef)), GRAY_SHIFT);
+                }
+                const __m256i lo = _mm256_packs_epi32(s[0], s[1]);
+                const __m256i hi = _mm256_packs_epi32(s[2], s[3]);
+                const __m256i px = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+                _mm256_storeu_si256((__m256i*)(dst + i), px);
+            }
+            scalarRow(rgb, dst + i, n - i);
+        }
+
+#       undef RGB_TO_GRAY_RG_MASK
+#       undef RGB_TO_GRAY_B_MASK
+
+        inline bool cpuHasSsse3()
+        {
+            unsigned int a, b, c, d;
+            if (__get_cpuid(1, &a, &b, &c, &d) == 0) return false;
+            return (c & bit_SSSE3) != 0;
+        }
+
+        inline bool cpuHasAvx2()
+        {
+            unsigned int a, b, c, d;
+            if (__get_cpuid(1, &a, &b, &c, &d) == 0) return false;
+            if ((c & bit_OSXSAVE) == 0 || (c & bit_AVX) == 0) return false;
+            // the OS has to save the ymm registers as well
+            unsigned int xcr0, xcr0Hi;
+            __asm__ volatile ("xgetbv" : "=a"(xcr0), "=d"(xcr0Hi) : "c"(0));
+            if ((xcr0 & 6) != 6) return false;
+            if (__get_cpuid_max(0, NULL) < 7) return false;
+            __cpuid_count(7, 0, a, b, c, d);
+            return (b & (1 << 5)) != 0;
+        }
+
+#endif
+
+#ifdef RGB_TO_GRAY_NEON
+
+        inline void neonRow(const unsigned char* rgb, unsigned char* dst, int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8, rgb += 24)
+            {
+                const uint8x8x3_t v = vld3_u8(rgb);
+                const uint16x4x2_t r = { { vget_low_u16(vmovl_u8(v.val[0])), vget_high_u16(vmovl_u8(v.val[0])) } };
+                const uint16x4x2_t g = { { vget_low_u16(vmovl_u8(v.val[1])), vget_high_u16(vmovl_u8(v.val[1])) } };
+                const uint16x4x2_t b = { { vget_low_u16(vmovl_u8(v.val[2])), vget_high_u16(vmovl_u8(v.val[2])) } };
+                uint16x4_t y[2];
+                for (int k = 0; k < 2; ++k)
+                {
+                    uint32x4_t s = vmull_n_u16(r.val[k], GRAY_COEF_R);
+                    s = vmlal_n_u16(s, g.val[k], GRAY_COEF_G);
+                    s = vmlal_n_u16(s, b.val[k], GRAY_COEF_B);
+                    y[k] = vrshrn_n_u32(s, GRAY_SHIFT);
+                }
+                vst1_u8(dst + i, vqmovn_u16(vcombine_u16(y[0], y[1])));
+            }
+            scalarRow(rgb, dst + i, n - i);
+        }
+
+#endif
+
+        /**
+         *  compares a kernel with scalarRow() bit for bit, over every row length up to 160
+         *  (all tail cases) and over all 2^24 colors. Too slow for startup, run by `make test-gray`.
+         */
+        inline bool verify(RowFunc func)
+        {
+            vector<unsigned char> rgb(1 << 15), expected(rgb.size() / 3), actual(rgb.size() / 3);
+            for (int n = 0; n <= 160; ++n)
+            {
+                for (int i = 0; i < n * 3; ++i) rgb[i] = (i * 97 + n * 31) & 0xff;
+                fill(actual.begin(), actual.end(), 0);
+                scalarRow(&rgb[0], &expected[0], n);
+                func(&rgb[0], &actual[0], n);
+                if (memcmp(&expected[0], &actual[0], n) != 0) return false;
+            }
+
+            const int chunk = expected.size();
+            for (int start = 0; start < (1 << 24); start += chunk)
+            {
+                const int n = MIN(chunk, (1 << 24) - start);
+                for (int i = 0; i < n; ++i)
+                {
+                    const int c = start + i;
+                    rgb[i * 3 + 0] = c >> 16;
+                    rgb[i * 3 + 1] = c >> 8;
+                    rgb[i * 3 + 2] = c;
+                }
+                scalarRow(&rgb[0], &expected[0], n);
+                func(&rgb[0], &actual[0], n);
+                if (memcmp(&expected[0], &actual[0], n) != 0) return false;
+            }
+            return true;
+        }
+
+        struct Kernel
+        {
+            RowFunc         func;
+            const char*     name;
+        };
+
+        /// the kernels this CPU can run, the best one last
+        inline vector<Kernel> getAvailableKernels()
+        {
+            vector<Kernel> kernels;
+            const Kernel scalar = { scalarRow, "scalar" };
+            kernels.push_back(scalar);
+#ifdef RGB_TO_GRAY_X86
+            if (cpuHasSsse3())
+            {
+                const Kernel k = { ssse3Row, "ssse3" };
+                kernels.push_back(k);
+            }
+            if (cpuHasAvx2())
+            {
+                const Kernel k = { avx2Row, "avx2" };
+                kernels.push_back(k);
+            }
+#endif
+#ifdef RGB_TO_GRAY_NEON
+            const Kernel neon = { neonRow, "neon" };
+            kernels.push_back(neon);
+#endif
+            return kernels;
+        }
+
+        inline Kernel selectKernel()
+        {
+            const Kernel k = getAvailableKernels().back();
+            LOG_NOTICE << "rgbToGray kernel: " << k.name;
+            return k;
+        }
+
+        // picked on first use
+        inline const Kernel& getKernel()
+        {
+            static const Kernel kernel = selectKernel();
+            return kernel;
+        }
+
+        inline void convertRow(const unsigned char* rgb, unsigned char* dst, int n)
+        {
+            getKernel().func(rgb, dst, n);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "ofMain.h"
+
+/**
+ *  Compares a frame with the last accepted one tile by tile (sum of absolute
+ *  differences). A tile is dirty when its mean absolute difference is above
+ *  the noise floor. The reference only moves on accept(), so a slow drift
+ *  still adds up until it is noticed.
+ */
+class TileChangeDetector
+{
+    vector<unsigned char>   mReference;
+    vector<unsigned int>    mTileSad;
+    vector<unsigned char>   mDirty;
+    int                     mWidth, mHeight;
+    int                     mTileSize, mTilesX, mTilesY;
+    int                     mNumDirty;
+    bool                    bValid;
+
+public:
+    TileChangeDetector()
+    : mWidth(0), mHeight(0), mTileSize(16), mTilesX(0), mTilesY(0), mNumDirty(0), bValid(false)
+    {}
+
+    void allocate(int w, int h, int tileSize = 16)
+    {
+        mWidth    = w;
+        mHeight   = h;
+        mTileSize = MAX(tileSize, 1);
+        mTilesX   = (w + mTileSize - 1) / mTileSize;
+        mTilesY   = (h + mTileSize - 1) / mTileSize;
+        mReference.assign(w * h, 0);
+        mTileSad.assign(mTilesX * mTilesY, 0);
+        mDirty.assign(mTilesX * mTilesY, 1);
+        mNumDirty = mTilesX * mTilesY;
+        bValid = false;
+    }
+
+    /// every tile is dirty until the next accept()
+    void invalidate() { bValid = false; }
+
+    /// marks the dirty tiles of frame (w x h, 1 channel) and returns how many there are
+    int update(const ofPixels& frame, int noiseFloor)
+    {
+        const int nTiles = mTilesX * mTilesY;
+        if (bValid == false)
+        {
+            std::fill(mDirty.begin(), mDirty.end(), 1);
+            mNumDirty = nTiles;
+            return mNumDirty;
+        }
+
+        std::fill(mTileSad.begin(), mTileSad.end(), 0);
+        const unsigned char* cur = frame.getPixels();
+        const unsigned char* ref = &mReference[0];
+        for (int y = 0; y < mHeight; ++y)
+        {
+            unsigned int* sad = &mTileSad[(y / mTileSize) * mTilesX];
+            const int row = y * mWidth;
+            for (int tx = 0; tx < mTilesX; ++tx)
+            {
+                const int x0 = tx * mTileSize;
+                const int x1 = MIN(x0 + mTileSize, mWidth);
+                unsigned int s = 0;
+                for (int x = row + x0; x < row + x1; ++x)
+                {
+                    s += abs((int)cur[x] - (int)ref[x]);
+                }
+                sad[tx] += s;
+            }
+        }
+
+        mNumDirty = 0;
+        for (int ty = 0; ty < mTilesY; ++ty)
+        {
+            const int th = MIN(mTileSize, mHeight - ty * mTileSize);
+            for (int tx = 0; tx < mTilesX; ++tx)
+            {
+                const int tw = MIN(mTileSize, mWidth - tx * mTileSize);
+                const int i = ty * mTilesX + tx;
+                mDirty[i] = mTileSad[i] > (unsigned int)(noiseFloor * tw * th);
+                mNumDirty += mDirty[i];
+            }
+        }
+        return mNumDirty;
+    }
+
+    /// frame becomes the reference for the next update()
+    void accept(const ofPixels& frame)
+    {
+        accept(frame, 0, mHeight);
+    }
+
+    /// only rows [rowBegin, rowEnd) of frame move into the reference, the
+    /// rest keeps accumulating against what was accepted before
+    void accept(const ofPixels& frame, int rowBegin, int rowEnd)
+    {
+        if (mReference.empty()) return;
+        rowBegin = MAX(rowBegin, 0);
+        rowEnd   = MIN(rowEnd, mHeight);
+        if (rowEnd > rowBegin)
+        {
+            memcpy(&mReference[rowBegin * mWidth], frame.getPixels() + rowBegin * mWidth, (rowEnd - rowBegin) * mWidth);
+        }
+        bValid = true;
+    }
+
+    /// pixel rows [rowBegin, rowEnd) covered by the dirty tiles, false when none is dirty
+    bool getDirtyRows(int& rowBegin, int& rowEnd) const
+    {
+        int t0 = mTilesY, t1 = -1;
+        for (int ty = 0; ty < mTilesY; ++ty)
+        {
+            for (int tx = 0; tx < mTilesX; ++tx)
+            {
+                if (mDirty[ty * mTilesX + tx] == 0) continue;
+                t0 = MIN(t0, ty);
+                t1 = ty;
+                break;
+            }
+        }
+        if (t1 < 0) return false;
+        rowBegin = t0 * mTileSize;
+        rowEnd   = MIN((t1 + 1) * mTileSize, mHeight);
+        return true;
+    }
+
+    bool isTileDirty(int tx, int ty) const  { return mDirty[ty * mTilesX + tx]; }
+    int getNumDirtyTiles() const            { return mNumDirty; }
+    int getNumTiles() const                 { return mTilesX * mTilesY; }
+    int getTileSize() const                 { return mTileSize; }
+    int getTilesX() const                   { return mTilesX; }
+    int getTilesY() const                   { return mTilesY; }
+};
@@ -14,9 +14,9 @@ protected:
     BLOB_TYPE mBlob;
     
 public:
-    BaseAnimation(const VisualBlobs* main, const BLOB_TYPE& blob) : mMain(main)
+    BaseAnimation(const VisualBlobs* main, const BlobView& blob) : mMain(main)
     {
-        mBlob = BLOB_TYPE(new Blob(blob.get()));
+        mBlob = BLOB_TYPE(new Blob(blob));
     }
     
     float getAlpha()
@@ -31,7 +31,7 @@ class TwinkBlob : public BaseAnimation
     ofColor mCol;
     
 public:
-    TwinkBlob(const VisualBlobs* main, const BLOB_TYPE& blob, ofColor col)
+    TwinkBlob(const VisualBlobs* main, const BlobView& blob, ofColor col)
     : BaseAnimation(main, blob)
     , mCol(col)
     {
@@ -58,7 +58,7 @@ class BlobEdge : public BaseAnimation
     ofVboMesh mMesh;
     
 public:
-    BlobEdge(const VisualBlobs* main, const BLOB_TYPE& blob, ofColor col)
+    BlobEdge(const VisualBlobs* main, const BlobView& blob, ofColor col)
     : BaseAnimation(main, blob)
     , mCol(col)
     {
@@ -118,17 +118,17 @@ class ParticleBlobEdge : public BaseAnimation
     int mNum;
     
 public:
-    ParticleBlobEdge(const VisualBlobs* main, const BLOB_TYPE& blob, ofColor col)
+    ParticleBlobEdge(const VisualBlobs* main, const BlobView& blob, ofColor col)
     : BaseAnimation(main, blob)
     , mCol(col)
     {
         mValiation = 0;
         mSize = ofRandom(100, 150);
         mNum = 0;
-        for (const auto& e : blob->pts)
+        for (const auto& e : mBlob->pts)
         {
-            mDeg.push_back(e.angle(blob->centroid));
-            mSpeed.push_back(blob->centroid.distance(e) * 2);
+            mDeg.push_back(e.angle(mBlob->centroid));
+            mSpeed.push_back(mBlob->centroid.distance(e) * 2);
             mPos.push_back(ofPoint(e.x * ofGetWidth(),
                                    e.y * ofGetHeight()));
             mNum++;
@@ -362,31 +362,31 @@ void VisualBlobs::blobNoteEvent(BlobNoteEvent &e)
 {
     if (e.channel == 1)
     {
-        mAnimations.createInstance<TwinkBlob>(this, e.blobPtr, ofColor(255, 255, 255))->play(6);
+        mAnimations.createInstance<TwinkBlob>(this, e.blob, ofColor(255, 255, 255))->play(6);
     }
     
     if (e.channel == 2)
     {
-        mAnimations.createInstance<BlobEdge>(this, e.blobPtr, ofColor(255, 255, 255))->play(1.5);
+        mAnimations.createInstance<BlobEdge>(this, e.blob, ofColor(255, 255, 255))->play(1.5);
     }
     
     if (e.channel == 3)
     {
-        mAnimations.createInstance<TwinkBlob>(this, e.blobPtr, ofColor::fromHsb(ofRandom(255), 255, 255))->play(0.5);
+        mAnimations.createInstance<TwinkBlob>(this, e.blob, ofColor::fromHsb(ofRandom(255), 255, 255))->play(0.5);
         
     }
     if (e.channel == 4)
     {
-        mAnimations.createInstance<BlobEdge>(this, e.blobPtr, ofColor::fromHsb(ofRandom(180, 200), 255, 255))->play(3);
-        mAnimations.createInstance<BlobEdge>(this, e.blobPtr, ofColor::fromHsb(ofRandom(180, 200), 255, 255))->play(4, 0.5);
+        mAnimations.createInstance<BlobEdge>(this, e.blob, ofColor::fromHsb(ofRandom(180, 200), 255, 255))->play(3);
+        mAnimations.createInstance<BlobEdge>(this, e.blob, ofColor::fromHsb(ofRandom(180, 200), 255, 255))->play(4, 0.5);
     }
     if (e.channel == 5)
     {
-        mAnimations.createInstance<BlobEdge>(this, e.blobPtr, ofColor(255, 255, 255))->play(6);
+        mAnimations.createInstance<BlobEdge>(this, e.blob, ofColor(255, 255, 255))->play(6);
     }
     if (e.channel == 6)
     {
-        mAnimations.createInstance<TwinkBlob>(this, e.blobPtr, ofColor::fromHsb(ofRandom(255), 120, 255))->play(9);
-        mAnimations.createInstance<BlobEdge>(this, e.blobPtr, ofColor(255, 255, 255))->play(9);
+        mAnimations.createInstance<TwinkBlob>(this, e.blob, ofColor::fromHsb(ofRandom(255), 120, 255))->play(9);
+        mAnimations.createInstance<BlobEdge>(this, e.blob, ofColor(255, 255, 255))->play(9);
     }
 }
@@ -5,6 +5,23 @@
 //------------------------------------------------------------------------------
 #define USE_CAMERA
 
+// play a raw frame file (SOURCE_FRAME_FILE) instead of the camera or the video
+//#define USE_FRAME_FILE
+
+// count heap allocations of the image pipeline and assert there are none in steady state
+//#define COUNT_FRAME_ALLOCATIONS
+
+// run the image processing and contour finding on a worker thread, the app only picks up finished frames
+#define USE_VISION_THREAD
+
+// an incremental frame only redoes the changed rows, so pixel changes below CHANGE_NOISE_FLOOR
+// leave the other rows as they were thresholded; after this many incremental frames the next
+// changed frame is redone whole (skipped frames do not count)
+static const int FULL_PASS_INTERVAL = 120;
+
+// debug textures of the image stages are freed after this many frames without being drawn
+static const int TEXTURE_RELEASE_FRAMES = 300;
+
 static const int        VISUAL_WINDOW_WIDTH  = 1440;
 static const int        VISUAL_WINDOW_HEIGHT = 900;
 static const string     MAIN_DISP_SERVER_NAME = "syphone";
@@ -15,12 +32,29 @@ static const string     MAIN_DISP_SERVER_NAME = "syphone";
 static const int CAMERA_DEVISE_ID = 0;
 static const int CAMERA_WIDTH     = 1280;
 static const int CAMERA_HEIGHT    = 720;
+// capture the luma plane only, set to false when a scene needs the colors of the camera
+static const bool   CAMERA_GRAY         = true;
+// raw frame file played as a stand-in camera (no hardware needed), empty for the real device
+static const string CAMERA_FAKE_DEVICE  = "";
 
 
 
 // VIDEO
 //------------------------------------------------------------------------------
 static const string SOURCE_VIDEO = "movie/sample.mp4";
+// decode the video to luma only, set to false when a scene needs the colors of the footage
+static const bool   SOURCE_VIDEO_GRAY = true;
+
+
+// FRAME FILE
+//------------------------------------------------------------------------------
+static const string SOURCE_FRAME_FILE = "recordings/rehearsal.frames";
+// frames per second, 0 for one frame per update (deterministic), -1 for the recorded rate
+static const float  SOURCE_FRAME_FILE_FPS = -1;
+// 'R' records the source frames into this folder
+static const string RECORDING_DIR = "recordings/";
+// frames a recording may wait for the disk, a recording that falls further behind fails
+static const int    RECORDING_BUFFER_FRAMES = 120;
 
 
 // MIDI
@@ -33,3 +67,9 @@ static const string MIDI_RECEIVER_PORT_NAME = "IAC Driver buss 2";
 //------------------------------------------------------------------------------
 static const string GUI_FILENAME = "settings.xml";
 
+
+// TIMING
+//------------------------------------------------------------------------------
+// per phase percentiles, appended once a second while enabled ('t' key)
+static const string PHASE_CSV_FILENAME = "phase_timing.csv";
+
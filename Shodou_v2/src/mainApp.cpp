@@ -9,10 +9,13 @@ void mainApp::setup()
     //----------
     // setup source image
     //----------
-#ifdef USE_CAMERA
-    mInputImage = new InputCameraController(CAMERA_WIDTH, CAMERA_HEIGHT, CAMERA_DEVISE_ID);
+#if defined(USE_FRAME_FILE)
+    mInputImage = new InputFileController(SOURCE_FRAME_FILE, SOURCE_FRAME_FILE_FPS);
+#elif defined(USE_CAMERA)
+    mInputImage = new InputCameraController(CAMERA_WIDTH, CAMERA_HEIGHT, CAMERA_DEVISE_ID,
+                                            CAMERA_GRAY, CAMERA_FAKE_DEVICE);
 #else
-    mInputImage = new InputVideoController(SOURCE_VIDEO);
+    mInputImage = new InputVideoController(SOURCE_VIDEO, SOURCE_VIDEO_GRAY);
 #endif
     
     //----------
@@ -32,6 +35,10 @@ void mainApp::setup()
     // init values
     //----------
     mMode = ON_SCREEN;
+    mLastContourFrame = 0;
+    mLastUpdateTime = PhaseTimer::Clock::now();
+    mLastLatency = PhaseTimer::Clock::duration::zero();
+    bWritePhaseCsv = false;
     
     //----------
     // setup GUI parameter
@@ -39,42 +46,62 @@ void mainApp::setup()
     mParamGroup.setName("PARAMETERS");
     mParamGroup.add(mInputImage->getParameterGroup());
     mParamGroup.add(mBlobThreshold.set("MASTER_THRESHOLD", 127, 0, 255));
+    mParamGroup.add(mSimplifyTolerance.set("SIMPLIFY_TOLERANCE", 0, 0, 8));
     gui.setup(mParamGroup, GUI_FILENAME);
     gui.loadFromFile(GUI_FILENAME);
     gui.minimizeAll();
     bDrawGui = true;
     mBlobThreshold.addListener(this, &mainApp::changedMasterThreshold);
+    mSimplifyTolerance.addListener(this, &mainApp::changedSimplifyTolerance);
+    mBlobDataController->setSimplification(mSimplifyTolerance);
 
 }
 
 void mainApp::update()
 {
+    //----------
+    // frame timing
+    //----------
+    const PhaseTimer::Clock::time_point now = PhaseTimer::Clock::now();
+    PhaseTimer::record(PhaseTimer::FRAME, now - mLastUpdateTime);
+    mLastUpdateTime = now;
+    PhaseTimer::update(bWritePhaseCsv ? ofToDataPath(PHASE_CSV_FILENAME) : "");
+    
     //----------
     // make marged input pixel
     //----------
+    mInputImage->setPreviewEnabled(mMode == PRE_PROCESS);
     mInputImage->update();
     
     //----------
     // update blob data controller
     //----------
-    mBlobDataController->update();
+    {
+        PhaseTimer::Scope timer(PhaseTimer::BLOB_UPDATE);
+        mBlobDataController->update();
+    }
     
     //----------
     // update visual
     //----------
-    mVisualBlob->update();
+    {
+        PhaseTimer::Scope timer(PhaseTimer::VISUAL_UPDATE);
+        mVisualBlob->update();
+    }
     
     //----------
     // automatic scan
     //----------
-    mBlobDataController->clearBlobs();
-    ofxCvContourFinder& cf = mInputImage->getCvContourFinder();
-    
-    int w = cf.getWidth();
-    int h = cf.getHeight();
-    for (auto& e : cf.blobs)
+    // blobs are only rebuilt when the contours were found again
+    if (mInputImage->getContourFrame() != mLastContourFrame)
     {
-        mBlobDataController->addBlob(e, w, h, 0);
+        PhaseTimer::Scope timer(PhaseTimer::BLOBS);
+        // contours carried over by the tracer keep the blob of the frame before
+        const bool bCarriedOver = mInputImage->getContourFrame() == mLastContourFrame + 1;
+        mLastContourFrame = mInputImage->getContourFrame();
+        mBlobDataController->updateBlobs(mInputImage->getContourSet(), bCarriedOver);
+        mLastLatency = PhaseTimer::Clock::now() - mInputImage->getCaptureTime();
+        PhaseTimer::record(PhaseTimer::LATENCY, mLastLatency);
     }
 }
 
@@ -83,7 +110,10 @@ void mainApp::draw()
     //----------
     // render visual
     //----------
-    mVisualBlob->rendering();
+    {
+        PhaseTimer::Scope timer(PhaseTimer::VISUAL_RENDER);
+        mVisualBlob->rendering();
+    }
     
     //----------
     // draw moniter
@@ -97,7 +127,10 @@ void mainApp::draw()
     
     if (bDrawGui)
     {
-        gui.draw();
+        {
+            PhaseTimer::Scope timer(PhaseTimer::GUI);
+            gui.draw();
+        }
         drawInfomationText(gui.getPosition().x, gui.getPosition().y + gui.getHeight() + 20);
     }
     ofSetWindowTitle(ofToString(ofGetFrameRate()));
@@ -128,8 +161,6 @@ void mainApp::drawPreProcess()
     e->getLimitedTexRef().draw(x, 0, w, h);
     e->drawCropRect(x, 0, w, h);
     offsetY += h;
-    e->getCropedTextureRef().draw(x, offsetY);
-    offsetY += e->getCropedPixelsRef().getHeight();
     e->getWarpedTextureRef().draw(x, offsetY);
     offsetY += e->getWarpedPixelsRef().getHeight();
     e->getBinaryTextureRef().draw(x, offsetY);
@@ -155,7 +186,7 @@ void mainApp::drawBlobControll()
     // blob image
     ofSetColor(255, 255, 255);
     mInputImage->getBinaryTextureRef().draw(0, 0, w, h);
-    mInputImage->getCvContourFinder().draw(0, 0, w, h);
+    mInputImage->getContourSet().draw(0, 0, w, h);
     
     // detected blobs
     mBlobDataController->draw(0, h, w, h);
@@ -179,6 +210,30 @@ void mainApp::drawInfomationText(float x, float y)
     stringstream s;
     s << "frame rate: " << ofGetFrameRate() << endl;
     s << "number of blobs: " << mBlobDataController->getBlobsRef().size() << endl;
+    s << "selected blobs (click / right click clears): " << mBlobDataController->getSelectionRef().size() << endl;
+    {
+        const unsigned long processed = mInputImage->getNumProcessedFrames();
+        const unsigned long skipped   = mInputImage->getNumSkippedFrames();
+        s << "frames processed/skipped: " << processed << "/" << skipped
+          << " (" << ofToString(100.0 * skipped / MAX(processed + skipped, 1), 1) << "% skipped)" << endl;
+        const unsigned long captured = mInputImage->getNumCapturedFrames();
+        const unsigned long dropped  = mInputImage->getNumDroppedFrames();
+        s << "frames captured/dropped: " << captured << "/" << dropped
+          << " (" << ofToString(100.0 * dropped / MAX(captured, 1), 1) << "% dropped)" << endl;
+        s << "capture to blobs: " << ofToString(std::chrono::duration<double, std::milli>(mLastLatency).count(), 1)
+          << " ms" << endl;
+        s << "dirty tiles: " << mInputImage->getNumDirtyTiles() << "/" << mInputImage->getNumTiles() << endl;
+        s << "contours carried over: " << mInputImage->getContourSet().getNumCarried()
+          << "/" << mInputImage->getContourSet().size() << endl;
+    }
+    s << PhaseTimer::getReport();
+    s << "timing csv (t): " << (bWritePhaseCsv ? PHASE_CSV_FILENAME : "off") << endl;
+    s << "recording (R): " << (mInputImage->isRecording() ? "on" : "off");
+    if (mInputImage->isRecordingFailed())
+    {
+        s << ", FAILED (" << mInputImage->getNumRecordingDropped() << " frames dropped)";
+    }
+    s << endl;
     s << mBlobDataController->getSequencerInfomationText() << endl;
     
     ofSetColor(0, 255, 0);
@@ -189,6 +244,10 @@ void mainApp::drawInfomationText(float x, float y)
 void mainApp::exit()
 {
     gui.saveToFile(GUI_FILENAME);
+    
+    // joins the vision worker while the shared thread pool is still alive
+    delete mInputImage;
+    mInputImage = NULL;
 }
 
 
@@ -218,6 +277,8 @@ void mainApp::keyPressed(int key)
         case '3': mMode = BLOB_CONTROLL; break;
             
         case ' ': bDrawGui = !bDrawGui; break;
+        case 't': bWritePhaseCsv = !bWritePhaseCsv; break;
+        case 'R': toggleRecording(); break;
             
             // sequencer
         case 'q': mBlobDataController->sequencerTogglePlay(0); break;
@@ -247,6 +308,16 @@ void mainApp::keyPressed(int key)
 
 void mainApp::mousePressed(int x, int y, int mouse)
 {
+    if (mMode != BLOB_CONTROLL) return;
+    
+    // both halves of the blob controll screen show the blobs over the full width
+    if (mouse == OF_MOUSE_BUTTON_RIGHT)
+    {
+        mBlobDataController->clearSelection();
+        return;
+    }
+    const float h = ofGetHeight() * 0.5;
+    selectBlobAtPoint(x / (float)ofGetWidth(), y < h ? y / h : (y - h) / h);
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -260,25 +331,49 @@ void mainApp::changedMasterThreshold(float& e)
     mInputImage->setThreshold(mBlobThreshold);
 }
 
-void mainApp::addBlobAtPoint(ofxCvContourFinder& contourFinder, float x, float y, float w, float h, float offsetW)
+void mainApp::changedSimplifyTolerance(float& e)
+{
+    mBlobDataController->setSimplification(mSimplifyTolerance);
+}
+
+void mainApp::toggleRecording()
 {
-    for (auto& e : contourFinder.blobs)
+    if (mInputImage->isRecording())
     {
-        if (e.boundingRect.inside(x, y))
+        mInputImage->stopRecording();
+        return;
+    }
+    ofDirectory::createDirectory(RECORDING_DIR, true, true);
+    mInputImage->startRecording(RECORDING_DIR + ofGetTimestampString() + ".frames");
+}
+
+void mainApp::selectBlobAtPoint(float x, float y)
+{
+    // the innermost stroke around (x, y) (normalized), with its holes and their islands
+    const BlobStore& blobs = mBlobDataController->getBlobsRef();
+    BlobView picked;
+    for (int i = 0; i < blobs.size() && picked.isValid() == false; i++)
+    {
+        const BlobView e = blobs[i];
+        if (e.getParent().isValid() == false && e.isHole() == false && e.getBoundingRect().inside(x, y))
+        {
+            picked = e;
+        }
+    }
+    BlobView e = picked.isValid() ? picked.getFirstChild() : BlobView();
+    while (e.isValid())
+    {
+        if (e.getBoundingRect().inside(x, y))
         {
-            // add blob
-            mBlobDataController->addBlob(e, w, h, offsetW);
-            // add inner blob
-            for (auto& f : contourFinder.blobs)
-            {
-                if (f.centroid.match(e.centroid) == false)
-                {
-                    if (e.boundingRect.inside(f.boundingRect))
-                    {
-                        mBlobDataController->addBlob(f, w, h, offsetW);
-                    }
-                }
-            }
+            if (e.isHole() == false) picked = e;
+            e = e.getFirstChild();
+        }
+        else {
+            e = e.getNextSibling();
         }
     }
+    if (picked.isValid())
+    {
+        mBlobDataController->selectBlobTree(picked);
+    }
 }
@@ -7,10 +7,13 @@
 #include "ImageProcessing.hpp"
 #include "ofxGui.h"
 #include "MidiSenderController.hpp"
+#include "PhaseTimer.hpp"
 
 class mainApp : public ofBaseApp
 {
-#ifdef USE_CAMERA
+#if defined(USE_FRAME_FILE)
+    InputImageController<RawFramePlayer>   *mInputImage;
+#elif defined(USE_CAMERA)
     InputImageController<ofVideoGrabber>   *mInputImage;
 #else
     InputImageController<ofVideoPlayer>    *mInputImage;
@@ -26,7 +29,12 @@ class mainApp : public ofBaseApp
     ofParameterGroup    mParamGroup;
     ofParameter<float>  mBlobThreshold;
     ofParameter<int>    mMaxNumBlobs;
+    ofParameter<float>  mSimplifyTolerance;
     bool bDrawGui;
+    unsigned long mLastContourFrame;
+    PhaseTimer::Clock::time_point mLastUpdateTime;
+    PhaseTimer::Clock::duration mLastLatency;     // capture to blobs of the last rebuild
+    bool bWritePhaseCsv;
     
 public:
     void setup();
@@ -45,5 +53,7 @@ public:
     void mousePressed(int x, int y, int mouse);
     
     void changedMasterThreshold(float& e);
-    void addBlobAtPoint(ofxCvContourFinder& contourFinder, float x, float y, float w, float h, float offsetW);
+    void changedSimplifyTolerance(float& e);
+    void toggleRecording();
+    void selectBlobAtPoint(float x, float y);
 };
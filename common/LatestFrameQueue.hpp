@@ -0,0 +1,82 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+/**
+ *  Capture to worker hand-over that holds one waiting frame: a frame that
+ *  was not picked up before the next one arrives is dropped, so the worker
+ *  always starts on the freshest frame and the latency stays bounded by one
+ *  frame of processing. Every frame carries its capture time, and the drops
+ *  are counted.
+ *
+ *      // capture thread
+ *      queue.push([&](ofPixels& slot){ copy(frame, slot); });
+ *
+ *      // worker thread
+ *      while (const LatestFrameQueue<ofPixels>::Entry* e = queue.waitPop()) process(e->value, e->captureTime);
+ */
+template<typename T>
+class LatestFrameQueue
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        T                   value;
+        Clock::time_point   captureTime;
+    };
+
+private:
+    Entry                       mSlots[2];
+    int                         mWrite;         // slot the producer fills, the consumer owns the other one
+    bool                        bNew;
+    bool                        bClosed;
+    std::mutex                  mMutex;
+    std::condition_variable     mCond;
+    std::atomic<unsigned long>  mNumPushed;
+    std::atomic<unsigned long>  mNumDropped;
+
+public:
+    LatestFrameQueue() : mWrite(0), bNew(false), bClosed(false), mNumPushed(0), mNumDropped(0) {}
+
+    /// producer: fill(slot) writes the frame, which replaces a frame still waiting
+    template<typename Fill>
+    void push(Fill fill, Clock::time_point captureTime = Clock::now())
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (bClosed) return;
+        fill(mSlots[mWrite].value);
+        mSlots[mWrite].captureTime = captureTime;
+        if (bNew) mNumDropped++;
+        bNew = true;
+        mNumPushed++;
+        mCond.notify_one();
+    }
+
+    /// consumer: waits for a frame, NULL once closed. The entry stays valid until the next call.
+    const Entry* waitPop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCond.wait(lock, [&]{ return bClosed || bNew; });
+        if (bClosed) return NULL;
+        const int read = mWrite;
+        mWrite = 1 - read;
+        bNew = false;
+        return &mSlots[read];
+    }
+
+    /// wakes the consumer, later pushes are ignored
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        bClosed = true;
+        mCond.notify_all();
+    }
+
+    unsigned long getNumPushed() const  { return mNumPushed; }
+    unsigned long getNumDropped() const { return mNumDropped; }
+};
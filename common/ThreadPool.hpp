@@ -0,0 +1,116 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/**
+ *  Fixed set of worker threads for data parallel loops.
+ *  parallelFor(n, f) runs f(0) .. f(n - 1) on the workers and the calling
+ *  thread and returns when all of them are done. A call made while the pool
+ *  is busy (from another thread, or nested inside a task) runs serially on
+ *  the calling thread instead of waiting.
+ */
+class ThreadPool
+{
+    std::vector<std::thread>            mThreads;
+    std::mutex                          mMutex;
+    std::mutex                          mBusy;
+    std::condition_variable             mWake;
+    std::condition_variable             mDone;
+    const std::function<void(int)>*     mTask;
+    std::atomic<int>                    mNext;
+    int                                 mCount;
+    int                                 mPending;
+    unsigned                            mGeneration;
+    bool                                bQuit;
+
+    void runTasks(int n)
+    {
+        for (int i = mNext++; i < n; i = mNext++)
+        {
+            (*mTask)(i);
+        }
+    }
+
+    void workerLoop()
+    {
+        unsigned generation = 0;
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mWake.wait(lock, [&]{ return bQuit || mGeneration != generation; });
+            if (bQuit) return;
+            generation = mGeneration;
+            const int n = mCount;
+            lock.unlock();
+            runTasks(n);
+            lock.lock();
+            if (--mPending == 0) mDone.notify_one();
+        }
+    }
+
+public:
+    explicit ThreadPool(int numThreads = std::thread::hardware_concurrency())
+    : mTask(NULL), mNext(0), mCount(0), mPending(0), mGeneration(0), bQuit(false)
+    {
+        for (int i = 1; i < numThreads; ++i)
+        {
+            mThreads.push_back(std::thread(&ThreadPool::workerLoop, this));
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            bQuit = true;
+        }
+        mWake.notify_all();
+        for (auto& e : mThreads) e.join();
+    }
+
+    void parallelFor(int n, const std::function<void(int)>& task)
+    {
+        std::unique_lock<std::mutex> busy(mBusy, std::try_to_lock);
+        if (mThreads.empty() || n <= 1 || busy.owns_lock() == false)
+        {
+            for (int i = 0; i < n; ++i) task(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTask = &task;
+            mNext = 0;
+            mCount = n;
+            mPending = mThreads.size();
+            ++mGeneration;
+        }
+        mWake.notify_all();
+        runTasks(n);
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [&]{ return mPending == 0; });
+    }
+
+    /// workers plus the calling thread
+    int getNumThreads() const { return mThreads.size() + 1; }
+
+    /// threads of the shared pool, only has an effect before the first getShared() (0: one per core)
+    static int& sharedNumThreads()
+    {
+        static int n = 0;
+        return n;
+    }
+
+    /// process wide pool, one thread per core unless sharedNumThreads() was set
+    static ThreadPool& getShared()
+    {
+        static ThreadPool pool(sharedNumThreads() > 0 ? sharedNumThreads() : std::thread::hardware_concurrency());
+        return pool;
+    }
+};
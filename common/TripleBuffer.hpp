@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ *  Single producer / single consumer hand-over of the latest value.
+ *  The producer fills getBack() and calls publish(); the consumer calls
+ *  update() and reads getFront(). Neither side ever waits: the third slot
+ *  sits in the middle and is swapped in with one atomic exchange, and a
+ *  value that was not picked up in time is simply replaced by a newer one.
+ */
+template<typename T>
+class TripleBuffer
+{
+    static const int INDEX_MASK = 3;
+    static const int NEW_BIT    = 4;    // the middle slot holds a value the consumer has not seen
+
+    T                   mSlots[3];
+    int                 mBack;          // producer only
+    int                 mFront;         // consumer only
+    std::atomic<int>    mMiddle;
+
+public:
+    TripleBuffer() : mBack(0), mFront(1), mMiddle(2) {}
+
+    /// producer: the slot to fill, it still holds whatever was published two times ago
+    T& getBack() { return mSlots[mBack]; }
+
+    /// producer: make the back slot the latest value
+    void publish()
+    {
+        mBack = mMiddle.exchange(mBack | NEW_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    /// consumer: take the latest value if there is a new one, returns true if the front changed
+    bool update()
+    {
+        if ((mMiddle.load(std::memory_order_relaxed) & NEW_BIT) == 0) return false;
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    /// consumer: the value taken by the last update()
+    T& getFront() { return mSlots[mFront]; }
+    const T& getFront() const { return mSlots[mFront]; }
+};